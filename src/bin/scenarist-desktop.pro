@@ -132,6 +132,7 @@ SOURCES += \
     scenarist-desktop/ManagementLayer/Scenario/ScenarioNavigatorManager.cpp \
     scenarist-desktop/ManagementLayer/Scenario/ScenarioCardsManager.cpp \
     scenarist-desktop/ManagementLayer/Settings/SettingsManager.cpp \
+    scenarist-desktop/ManagementLayer/Settings/DictionaryDownloader.cpp \
     scenarist-desktop/ManagementLayer/StartUp/StartUpManager.cpp \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScenarioNavigator/ScenarioNavigator.cpp \
     scenarist-core/BusinessLayer/ScenarioDocument/ScenarioDocument.cpp \
@@ -387,6 +388,7 @@ HEADERS += \
     scenarist-desktop/ManagementLayer/Scenario/ScenarioNavigatorManager.h \
     scenarist-desktop/ManagementLayer/Scenario/ScenarioCardsManager.h \
     scenarist-desktop/ManagementLayer/Settings/SettingsManager.h \
+    scenarist-desktop/ManagementLayer/Settings/DictionaryDownloader.h \
     scenarist-desktop/ManagementLayer/StartUp/StartUpManager.h \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScenarioNavigator/ScenarioNavigator.h \
     scenarist-core/BusinessLayer/ScenarioDocument/ScenarioDocument.h \
@@ -45,7 +45,9 @@
 
 #include <QApplication>
 #include <QComboBox>
+#include <QDebug>
 #include <QDesktopServices>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QLabel>
 #include <QMenu>
@@ -596,113 +598,152 @@ void ApplicationManager::aboutSave()
     }
 
     //
-    // Если какие-то данные изменены
+    // Если какие-то данные изменены и сохранение не выполняется в данный момент
+    // (например, пока открыт диалог об ошибке предыдущего сохранения, во время которого
+    // может прийти событие простоя приложения)
     //
-    if (m_view->isWindowModified()) {
+    if (m_view->isWindowModified()
+        && !m_isSaveInProgress) {
+        m_isSaveInProgress = true;
+        m_isChangesDiscarded = false;
+
         //
-        // Перед сохранением проверяем достаточно ли места на диске, если нет, то уведомляем пользователя
+        // Перед сохранением проверяем достаточно ли места на диске
         //
-        const QStorageInfo storageInfo(DatabaseLayer::Database::currentFile());
-        if (storageInfo.bytesAvailable()/1000/1000 < 50) {
-            QLightBoxMessage::warning(
-                        m_view,
-                        tr("Possible save error"),
-                        tr("You have less than 50 megabytes of free disk space. This can lead to problems "
-                           "with saving the project. We recommend that you free up more space "
-                           "and check whether the project is saved correctly."));
-        }
+        checkFreeDiskSpace();
 
         //
         // Управляющие должны сохранить несохранённые данные
         //
+        // NOTE: Формирование данных и запись в базу выполняются синхронно в потоке интерфейса.
+        //       Отдельный поток записи с собственным соединением здесь невозможен: запись идёт
+        //       через хранилища и мапперы ядра, которые держат единственное соединение и кэш
+        //       объектов с их идентификаторами, а документы сценария принадлежат потоку
+        //       интерфейса. Стоимость сохранения снижает инкрементальное сохранение текста
+        //       в ScenarioManager, а в фоне выполняются только проверка места на диске
+        //       и резервное копирование
+        //
         DatabaseLayer::Database::transaction();
         m_researchManager->saveResearch();
         m_scenarioManager->saveCurrentProject();
         DatabaseLayer::Database::commit();
 
         //
-        // Обновим информацию о последнем изменении
+        // Уведомляем о результате сохранения
+        //
+        emit saveFinished(!DatabaseLayer::Database::hasError());
+    }
+
+    //
+    // Для проекта из облака синхронизируем данные
+    //
+    if (m_projectsManager->currentProject().isRemote()) {
+        m_synchronizationManager->aboutWorkSyncScenario();
+        m_synchronizationManager->aboutWorkSyncData();
+    }
+}
+
+void ApplicationManager::aboutSaveFinished(bool _success)
+{
+    //
+    // Обновим информацию о последнем изменении
+    //
+    aboutUpdateLastChangeInfo();
+
+    //
+    // Если всё успешно сохранилось
+    //
+    if (_success) {
+        m_isSaveInProgress = false;
+
+        //
+        // Изменим статус окна на сохранение изменений
         //
-        aboutUpdateLastChangeInfo();
+        ::updateWindowModified(m_view, false);
 
         //
-        // Если всё успешно сохранилось
+        // Если необходимо создадим резервную копию закрываемого файла
         //
-        if (!DatabaseLayer::Database::hasError()) {
+        QString baseBackupName;
+        const Project& currentProject = ProjectsManager::currentProject();
+        if (currentProject.isRemote()) {
             //
-            // Изменим статус окна на сохранение изменений
+            // Для удаленных проектов имя бекапа - имя проекта + id проекта
+            // В случае, если имя удаленного проекта изменилось, то бэкапы со старым именем останутся навсегда
             //
-            ::updateWindowModified(m_view, false);
+            baseBackupName = QString("%1 [%2]").arg(currentProject.name()).arg(currentProject.id());
+        }
+        QtConcurrent::run(&m_backupHelper, &BackupHelper::saveBackup, ProjectsManager::currentProject().path(), baseBackupName);
+    }
+    //
+    // А если ошибка сохранения, то делаем дополнительные проверки и работаем с пользователем
+    //
+    else {
+        //
+        // Т.к. неизвестно, какие из изменений успели записаться, при следующем сохранении
+        // запишем разработку целиком
+        //
+        m_researchManager->markAllResearchChanged();
 
+        //
+        // Если файл, в который мы пробуем сохранять изменения существует
+        //
+        if (QFile::exists(DatabaseLayer::Database::currentFile())) {
             //
-            // Если необходимо создадим резервную копию закрываемого файла
+            // ... то у нас случилась какая-то внутренняя ошибка базы данных
             //
-            QString baseBackupName;
-            const Project& currentProject = ProjectsManager::currentProject();
-            if (currentProject.isRemote()) {
-                //
-                // Для удаленных проектов имя бекапа - имя проекта + id проекта
-                // В случае, если имя удаленного проекта изменилось, то бэкапы со старым именем останутся навсегда
-                //
-                baseBackupName = QString("%1 [%2]").arg(currentProject.name()).arg(currentProject.id());
+            const QDialogButtonBox::StandardButton messageResult =
+                    QLightBoxMessage::critical(m_view, tr("Saving error"),
+                                               tr("Can't write your changes to the project. There is a internal database error: %1 "
+                                                  "Please check, if this file exists and if you have permissions to write. Retry (to save)?")
+                                               .arg(DatabaseLayer::Database::lastError()),
+                                               QDialogButtonBox::Yes | QDialogButtonBox::No, QDialogButtonBox::Yes);
+            m_isSaveInProgress = false;
+            //
+            // ... пробуем повторно открыть базу данных и записать в неё изменения
+            //
+            if (messageResult == QDialogButtonBox::Yes) {
+                DatabaseLayer::Database::setCurrentFile(DatabaseLayer::Database::currentFile());
+                aboutSave();
             }
-            QtConcurrent::run(&m_backupHelper, &BackupHelper::saveBackup, ProjectsManager::currentProject().path(), baseBackupName);
         }
         //
-        // А если ошибка сохранения, то делаем дополнительные проверки и работаем с пользователем
+        // Файла с базой данных не найдено
         //
         else {
             //
-            // Если файл, в который мы пробуем сохранять изменения существует
+            // ... возможно файл был на флешке, а она отошла, или файл был переименован во время работы программы
             //
-            if (QFile::exists(DatabaseLayer::Database::currentFile())) {
-                //
-                // ... то у нас случилась какая-то внутренняя ошибка базы данных
-                //
-                const QDialogButtonBox::StandardButton messageResult =
-                        QLightBoxMessage::critical(m_view, tr("Saving error"),
-                                                   tr("Can't write your changes to the project. There is a internal database error: %1 "
-                                                      "Please check, if this file exists and if you have permissions to write. Retry (to save)?")
-                                                   .arg(DatabaseLayer::Database::lastError()),
-                                                   QDialogButtonBox::Yes | QDialogButtonBox::No, QDialogButtonBox::Yes);
-                //
-                // ... пробуем повторно открыть базу данных и записать в неё изменения
-                //
-                if (messageResult == QDialogButtonBox::Yes) {
-                    DatabaseLayer::Database::setCurrentFile(DatabaseLayer::Database::currentFile());
-                    aboutSave();
-                }
-            }
+            const QDialogButtonBox::StandardButton messageResult =
+                    QLightBoxMessage::critical(m_view, tr("Saving error"),
+                        tr("Can't write your changes to project located at <b>%1</b>, because the file doesn't exist. "
+                           "Please move the file back and retry saving. Retry saving")
+                            .arg(DatabaseLayer::Database::currentFile()),
+                        QDialogButtonBox::Yes | QDialogButtonBox::No, QDialogButtonBox::Yes);
+            m_isSaveInProgress = false;
             //
-            // Файла с базой данных не найдено
+            // ... пробуем повторно сохранить изменения в базу данных
             //
-            else {
-                //
-                // ... возможно файл был на флешке, а она отошла, или файл был переименован во время работы программы
-                //
-                const QDialogButtonBox::StandardButton messageResult =
-                        QLightBoxMessage::critical(m_view, tr("Saving error"),
-                            tr("Can't write your changes to project located at <b>%1</b>, because the file doesn't exist. "
-                               "Please move the file back and retry saving. Retry saving")
-                                .arg(DatabaseLayer::Database::currentFile()),
-                            QDialogButtonBox::Yes | QDialogButtonBox::No, QDialogButtonBox::Yes);
-                //
-                // ... пробуем повторно сохранить изменения в базу данных
-                //
-                if (messageResult == QDialogButtonBox::Yes) {
-                    aboutSave();
-                }
+            if (messageResult == QDialogButtonBox::Yes) {
+                aboutSave();
             }
         }
     }
+}
 
+void ApplicationManager::checkFreeDiskSpace()
+{
     //
-    // Для проекта из облака синхронизируем данные
+    // Если предыдущая проверка ещё не завершилась, то новую не запускаем
     //
-    if (m_projectsManager->currentProject().isRemote()) {
-        m_synchronizationManager->aboutWorkSyncScenario();
-        m_synchronizationManager->aboutWorkSyncData();
+    if (m_freeDiskSpaceWatcher.isRunning()) {
+        return;
     }
+
+    const QString projectPath = DatabaseLayer::Database::currentFile();
+    m_freeDiskSpaceWatcher.setFuture(QtConcurrent::run([projectPath] {
+        return QStorageInfo(projectPath).bytesAvailable();
+    }));
 }
 
 void ApplicationManager::aboutStartNewVersion()
@@ -815,6 +856,8 @@ void ApplicationManager::aboutLoad(const QString& _fileName)
             }
         }
 
+        m_isSaveInProgress = false;
+
         //
         // Изменим статус окна на сохранение изменений
         //
@@ -1386,15 +1429,30 @@ void ApplicationManager::aboutSyncClosedWithError(int _errorCode, const QString&
 
 void ApplicationManager::aboutImport()
 {
+    //
+    // Пока выполняется импорт, новый не запускаем
+    //
+    if (m_importManager->isImportInProgress()) {
+        return;
+    }
+
+    //
+    // Импорт выполняется асинхронно, рабочее состояние восстанавливается по его завершении
+    //
     m_state = ApplicationState::Importing;
     m_importManager->importScenario(m_scenarioManager->scenario(), m_scenarioManager->cursorPosition());
-    m_researchManager->loadScenarioData();
-
-    m_state = ApplicationState::Working;
+    if (!m_importManager->isImportInProgress()) {
+        m_state = ApplicationState::Working;
+    }
 }
 
 void ApplicationManager::aboutExport()
 {
+    //
+    // Для экспорта разработки нужна загруженная модель
+    //
+    loadDeferredModule(RESEARCH_TAB_INDEX);
+
     m_exportManager->exportScenario(m_scenarioManager->scenario(), m_researchManager->scenarioData());
 }
 
@@ -1550,6 +1608,14 @@ bool ApplicationManager::event(QEvent* _event)
         if (m_autosaveTimer.isActive()) {
             aboutSave();
         }
+
+        //
+        // Во время простоя загружаем по одному модулю, загрузка которых была отложена
+        //
+        if (m_state == ApplicationState::Working
+            && !m_deferredTabs.isEmpty()) {
+            loadDeferredModule(*m_deferredTabs.begin());
+        }
         _event->accept();
         result = true;
     } else {
@@ -1656,6 +1722,14 @@ void ApplicationManager::currentTabIndexChanged()
                 m_tabsWidgetsSecondary->addWidget(widget);
                 m_tabsWidgetsSecondary->setCurrentWidget(widget);
             }
+
+            //
+            // Загрузим данные показанных модулей, если это ещё не было сделано
+            //
+            loadDeferredModule(m_tabs->currentTab());
+            if (m_tabsSecondary->isVisible()) {
+                loadDeferredModule(m_tabsSecondary->currentTab());
+            }
         }
 
         processedNow = false;
@@ -1696,6 +1770,7 @@ bool ApplicationManager::saveIfNeeded()
                 aboutSave();
             } else {
                 ::updateWindowModified(m_view, false);
+                m_isChangesDiscarded = true;
             }
         } else {
             success = false;
@@ -1709,6 +1784,9 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
 {
     m_state = ApplicationState::ProjectLoading;
 
+    QElapsedTimer loadingTimer;
+    loadingTimer.start();
+
     //
     // Покажем уведомление пользователю
     //
@@ -1767,17 +1845,16 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
     }
 
     //
-    // FIXME: Если были изменения связанные с текстом сценария перестраиваем карточки
-    //        т.к. там нет пока синхронизации
+    // Карточки, дерево разработки и статистику загружаем при первом показе их вкладки,
+    // или во время простоя, чтобы как можно быстрее дать пользователю работать с текстом.
+    // Делать это нужно после того, как все данные синхронизировались
     //
-    m_scenarioManager->rebuildCardsFromScript();
+    m_deferredTabs = QSet<int>() << RESEARCH_TAB_INDEX << SCENARIO_CARDS_TAB_INDEX << STATISTICS_TAB_INDEX;
 
     //
-    // Загрузить данные из файла
-    // Делать это нужно после того, как все данные синхронизировались
+    // Данные сценария загружаем сразу, т.к. они нужны другим модулям
     //
-    m_researchManager->loadCurrentProject();
-    m_statisticsManager->loadCurrentProject();
+    m_researchManager->loadScenarioData();
 
     //
     // После того, как все данные загружены и синхронизированы, сохраняем проект
@@ -1787,15 +1864,6 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
         aboutSave();
     }
 
-    //
-    // Затем импортируем данные из указанного файла, если необходимо
-    //
-    if (!_importFilePath.isEmpty()) {
-        progress.setProgressText(tr("Import"), tr("Please wait. Import can take few minutes."));
-        m_importManager->importScenario(m_scenarioManager->scenario(), _importFilePath);
-        m_researchManager->loadScenarioData();
-    }
-
     //
     // Запускаем обработку изменений сценария
     //
@@ -1805,12 +1873,19 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
     // Загрузить настройки файла
     // Порядок загрузки важен - сначала настройки каждого модуля, потом активные вкладки
     //
-    m_researchManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_scenarioManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_exportManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_toolsManager->loadCurrentProjectSettings();
     loadCurrentProjectSettings(ProjectsManager::currentProject().path());
 
+    //
+    // Загрузим данные активных вкладок, т.к. если вкладка не сменилась, то сигнал о смене не придёт
+    //
+    loadDeferredModule(m_tabs->currentTab());
+    if (m_tabsSecondary->isVisible()) {
+        loadDeferredModule(m_tabsSecondary->currentTab());
+    }
+
     //
     // Обновим название текущего проекта, т.к. данные о проекте теперь загружены
     //
@@ -1834,16 +1909,39 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
     QApplication::processEvents();
     progress.finish();
 
+    qDebug() << "Project is ready for editing in" << loadingTimer.elapsed() << "ms";
+
     m_state = ApplicationState::Working;
+
+    //
+    // Затем импортируем данные из указанного файла, если необходимо
+    //
+    if (!_importFilePath.isEmpty()) {
+        m_state = ApplicationState::Importing;
+        m_importManager->importScenario(m_scenarioManager->scenario(), _importFilePath);
+        if (!m_importManager->isImportInProgress()) {
+            m_state = ApplicationState::Working;
+        }
+    }
 }
 
 void ApplicationManager::closeCurrentProject()
 {
+    //
+    // Незавершённый импорт прерываем, в закрываемый проект он уже ничего не добавит
+    //
+    if (m_importManager->isImportInProgress()) {
+        m_importManager->cancelImport();
+        m_state = ApplicationState::Working;
+    }
+
     if (isProjectLoaded()) {
         //
         // Сохраним настройки закрываемого проекта
         //
-        m_researchManager->saveCurrentProjectSettings(ProjectsManager::currentProject().path());
+        if (!m_deferredTabs.contains(RESEARCH_TAB_INDEX)) {
+            m_researchManager->saveCurrentProjectSettings(ProjectsManager::currentProject().path());
+        }
         m_scenarioManager->saveCurrentProjectSettings(ProjectsManager::currentProject().path());
         m_exportManager->saveCurrentProjectSettings(ProjectsManager::currentProject().path());
         saveCurrentProjectSettings(ProjectsManager::currentProject().path());
@@ -1852,7 +1950,9 @@ void ApplicationManager::closeCurrentProject()
         // Закроем проект управляющими
         //
         m_researchManager->closeCurrentProject();
-        m_scenarioManager->closeCurrentProject();
+        m_scenarioManager->closeCurrentProject(m_isChangesDiscarded);
+        m_isChangesDiscarded = false;
+        m_deferredTabs.clear();
 
         //
         // Очистим все загруженные на текущий момент данные
@@ -1893,6 +1993,35 @@ bool ApplicationManager::isProjectLoaded() const
     return m_projectsManager->isCurrentProjectValid();
 }
 
+void ApplicationManager::loadDeferredModule(int _tabIndex)
+{
+    if (!m_deferredTabs.remove(_tabIndex)) {
+        return;
+    }
+
+    switch (_tabIndex) {
+        case RESEARCH_TAB_INDEX: {
+            m_researchManager->loadCurrentProject();
+            m_researchManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
+            break;
+        }
+
+        case SCENARIO_CARDS_TAB_INDEX: {
+            m_scenarioManager->loadCards();
+            break;
+        }
+
+        case STATISTICS_TAB_INDEX: {
+            m_statisticsManager->loadCurrentProject();
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
 void ApplicationManager::initControllers()
 {
     m_exportManager->setResearchModel(m_researchManager->model());
@@ -2083,6 +2212,21 @@ void ApplicationManager::initConnections()
 {
     connect(m_view, SIGNAL(wantToClose()), this, SLOT(aboutExit()));
 
+    connect(this, &ApplicationManager::saveFinished, this, &ApplicationManager::aboutSaveFinished);
+    connect(&m_freeDiskSpaceWatcher, &QFutureWatcher<qint64>::finished, this, [this] {
+        //
+        // Если места на диске недостаточно, то уведомляем пользователя
+        //
+        if (m_freeDiskSpaceWatcher.result()/1000/1000 < 50) {
+            QLightBoxMessage::warning(
+                        m_view,
+                        tr("Possible save error"),
+                        tr("You have less than 50 megabytes of free disk space. This can lead to problems "
+                           "with saving the project. We recommend that you free up more space "
+                           "and check whether the project is saved correctly."));
+        }
+    });
+
     connect(m_menu, &FlatButton::clicked, m_menuManager, &MenuManager::showMenu);
 
     connect(m_tabs, &SideTabBar::currentChanged, this, &ApplicationManager::currentTabIndexChanged);
@@ -2171,6 +2315,11 @@ void ApplicationManager::initConnections()
     connect(m_scenarioManager, SIGNAL(scenarioChanged()), this, SLOT(aboutProjectChanged()));
     connect(m_exportManager, SIGNAL(scenarioTitleListDataChanged()), this, SLOT(aboutProjectChanged()));
 
+    connect(m_importManager, &ImportManager::importFinished, [this] {
+        m_researchManager->loadScenarioData();
+        m_state = ApplicationState::Working;
+    });
+
     connect(m_synchronizationManager, &SynchronizationManager::syncClosedWithError, this, &ApplicationManager::aboutSyncClosedWithError);
     connect(m_synchronizationManager, &SynchronizationManager::networkStatusChanged, this, &ApplicationManager::setSyncIndicator);
     connect(m_synchronizationManager, &SynchronizationManager::logoutFinished, m_tabs, &SideTabBar::removeIndicator);
@@ -3,7 +3,9 @@
 
 #include <3rd_party/Helpers/BackupHelper.h>
 
+#include <QFutureWatcher>
 #include <QObject>
+#include <QSet>
 #include <QTimer>
 
 class FlatButton;
@@ -65,6 +67,14 @@ namespace ManagementLayer
          */
         void makeStartUpChecks();
 
+    signals:
+        /**
+         * @brief Сохранение проекта завершено
+         * @note Испускается синхронно в конце сохранения, которое целиком выполняется в потоке
+         *       интерфейса, т.е. сигнал лишь уведомляет о результате и не означает асинхронности
+         */
+        void saveFinished(bool _success);
+
     private slots:
         /**
          * @brief Обновить списки проектов на стартовой странице
@@ -95,6 +105,18 @@ namespace ManagementLayer
          */
         void aboutSave();
 
+        /**
+         * @brief Обработать завершение сохранения
+         */
+        void aboutSaveFinished(bool _success);
+
+        /**
+         * @brief Проверить свободное место на диске с файлом проекта
+         * @note Проверка выполняется в отдельном потоке, т.к. для сетевых и съёмных дисков
+         *       она может занимать длительное время
+         */
+        void checkFreeDiskSpace();
+
         /**
          * @brief Начать новую версию сценария
          */
@@ -267,6 +289,11 @@ namespace ManagementLayer
          */
         bool isProjectLoaded() const;
 
+        /**
+         * @brief Загрузить данные модуля, загрузка которого была отложена при открытии проекта
+         */
+        void loadDeferredModule(int _tabIndex);
+
     private:
         /**
          * @brief Настроить контроллеры
@@ -421,6 +448,26 @@ namespace ManagementLayer
          */
         BackupHelper m_backupHelper;
 
+        /**
+         * @brief Наблюдатель за проверкой свободного места на диске
+         */
+        QFutureWatcher<qint64> m_freeDiskSpaceWatcher;
+
+        /**
+         * @brief Выполняется ли сохранение в данный момент
+         */
+        bool m_isSaveInProgress = false;
+
+        /**
+         * @brief Отказался ли пользователь от сохранения изменений перед закрытием проекта
+         */
+        bool m_isChangesDiscarded = false;
+
+        /**
+         * @brief Вкладки, загрузка данных которых отложена до их первого показа, или простоя
+         */
+        QSet<int> m_deferredTabs;
+
         /**
          * @brief Состояние приложения в данный момент
          */
@@ -24,9 +24,12 @@
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxprogress.h>
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxmessage.h>
 
-#include <QApplication>
+#include <format_manager.h>
+#include <format_reader.h>
+
 #include <QFile>
 #include <QSet>
+#include <QtConcurrent>
 
 using ManagementLayer::ImportManager;
 using UserInterface::ImportDialog;
@@ -49,16 +52,30 @@ namespace {
     const QString kCeltxExtension = ".celtx";
     /** @} */
 
+    /**
+     * @brief Привести список элементов разработки к заданному набору имён
+     * @note Существующие имена запрашиваются один раз, в хранилище отправляется только разница
+     */
+    template<typename RemoveFunction, typename StoreFunction>
+    static void syncResearchNames(const QList<DomainObject*>& _existingItems, const QSet<QString>& _names,
+        RemoveFunction _remove, StoreFunction _store) {
+        QSet<QString> existingNames;
+        for (DomainObject* domainObject : _existingItems) {
+            existingNames.insert(dynamic_cast<Research*>(domainObject)->name());
+        }
+
+        for (const QString& name : existingNames - _names) {
+            _remove(name);
+        }
+        for (const QString& name : _names - existingNames) {
+            _store(name);
+        }
+    }
+
     /**
      * @brief Сохранить импортированный документ разработки со вложенными документами
      */
     static void storeResearchDocument(const QVariantMap& _documentData, Domain::Research* _parent) {
-        //
-        // Т.к. разработка может быть довольно большой, то нужно давать выполняться гуи-потоку,
-        // чтобы не было ощущения зависания
-        //
-        QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-
         //
         // Загружаем базовые поля
         //
@@ -147,39 +164,204 @@ namespace {
 
 ImportManager::ImportManager(QObject* _parent, QWidget* _parentWidget) :
     QObject(_parent),
-    m_importDialog(new ImportDialog(_parentWidget))
+    m_importDialog(new ImportDialog(_parentWidget)),
+    m_importCanceled(new QAtomicInt(0))
 {
     initView();
     initConnections();
 }
 
-bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+ImportManager::~ImportManager()
+{
+    cancelImport();
+}
+
+void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath)
+{
+    BusinessLogic::ImportParameters importParameters;
+    importParameters.filePath = _importFilePath;
+    startImport(_scenario, 0, importParameters);
+}
+
+void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition)
+{
+    if (isImportInProgress()) {
+        return;
+    }
+
+    if (m_importDialog->exec() == QLightBoxDialog::Accepted) {
+        BusinessLogic::ImportParameters importParameters = m_importDialog->importParameters();
+
+        //
+        // Формат MS DOC не поддерживается, он отображается только для того, чтобы пользователи
+        // не теряли свои файлы
+        //
+        if (importParameters.filePath.toLower().endsWith(kMsDocExtension)) {
+            QLightBoxMessage::critical(m_importDialog, tr("File format not supported"),
+                tr("Microsoft <b>DOC</b> files are not supported. You need save it to <b>DOCX</b> file and reimport."));
+            return;
+        }
+
+        //
+        // Если файла не существует, уведомим об этом
+        //
+        if (!QFile::exists(importParameters.filePath)) {
+            QLightBoxMessage::critical(m_importDialog, tr("File doesn't exists"),
+                tr("Please choose existing file and retry import."));
+            return;
+        }
+
+        //
+        // Импортируем
+        //
+        startImport(_scenario, _cursorPosition, importParameters);
+    }
+}
+
+bool ImportManager::isImportInProgress() const
+{
+    return !m_importer.isNull();
+}
+
+void ImportManager::cancelImport()
+{
+    if (!isImportInProgress()) {
+        return;
+    }
+
+    //
+    // Ридеры форматов прервутся при ближайшем отчёте о прогрессе, остальные импортёры
+    // дорабатывают до конца, но их результат будет отброшен
+    //
+    m_importCanceled->storeRelease(1);
+    m_importWatcher.waitForFinished();
+    clearImport();
+}
+
+void ImportManager::startImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
     const BusinessLogic::ImportParameters& _importParameters)
 {
     //
-    // Получим xml-представление импортируемого сценария
+    // Пока выполняется предыдущий импорт, новый не начинаем
+    //
+    if (isImportInProgress()) {
+        return;
+    }
+
+    //
+    // Определим импортёр
     //
-    QScopedPointer<BusinessLogic::AbstractImporter> importer;
     if (_importParameters.filePath.toLower().endsWith(kKitScenaristExtension)) {
-        importer.reset(new BusinessLogic::KitScenaristImporter);
+        m_importer.reset(new BusinessLogic::KitScenaristImporter);
     } else if (_importParameters.filePath.toLower().endsWith(kFinalDraftExtension)
                || _importParameters.filePath.toLower().endsWith(kFinalDraftTemplateExtension)) {
-        importer.reset(new BusinessLogic::FdxImporter);
+        m_importer.reset(new BusinessLogic::FdxImporter);
     } else if (_importParameters.filePath.toLower().endsWith(kTrelbyExtension)) {
-        importer.reset(new BusinessLogic::TrelbyImporter);
+        m_importer.reset(new BusinessLogic::TrelbyImporter);
     } else if (_importParameters.filePath.toLower().endsWith(kFountainExtension)) {
-        importer.reset(new BusinessLogic::FountainImporter);
+        m_importer.reset(new BusinessLogic::FountainImporter);
     } else if (_importParameters.filePath.toLower().endsWith(kCeltxExtension)) {
-        importer.reset(new BusinessLogic::CeltxImporter);
+        m_importer.reset(new BusinessLogic::CeltxImporter);
     } else {
-        importer.reset(new BusinessLogic::DocumentImporter);
+        m_importer.reset(new BusinessLogic::DocumentImporter);
+    }
+    m_importParameters = _importParameters;
+    m_importScenario = _scenario;
+    m_importCursorPosition = _cursorPosition;
+    m_importCanceled = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+
+    //
+    // Покажем уведомление пользователю
+    //
+    m_importProgress = new QLightBoxProgress(m_importDialog->parentWidget());
+    m_importProgress->showProgress(tr("Import"), tr("Please wait. Import can take few minutes."));
+
+    //
+    // Разбираем файл в фоновом потоке
+    //
+    // NOTE: Импортёры сценария в importScript читают только заданный файл и не обращаются
+    //       к StorageFacade и соединению с базой данных проекта, которые принадлежат потоку
+    //       интерфейса. KitScenaristImporter открывает импортируемый проект собственным
+    //       соединением, которое создаётся и закрывается в том же потоке. А вот importResearch
+    //       заполняет хранилища, поэтому он выполняется после разбора в потоке интерфейса
+    //
+    BusinessLogic::AbstractImporter* importer = m_importer.data();
+    const BusinessLogic::ImportParameters importParameters = m_importParameters;
+    const QSharedPointer<QAtomicInt> canceled = m_importCanceled;
+    m_importWatcher.setFuture(QtConcurrent::run([this, importer, importParameters, canceled] {
+        //
+        // Ридеры форматов, которые импортёр создаёт в этом потоке, сообщают о прогрессе
+        // чтения и прерываются при отмене импорта
+        //
+        int lastProgress = -1;
+        FormatManager::setThreadReaderSetup([this, canceled, &lastProgress] (FormatReader* _reader) {
+            _reader->setProgressHandler([this, canceled, &lastProgress, _reader] (qint64 _processed, qint64 _total) {
+                if (_total > 0) {
+                    const int progress = qBound<qint64>(0, _processed * 100 / _total, 100);
+                    if (progress != lastProgress) {
+                        lastProgress = progress;
+                        emit importProgressChanged(progress);
+                    }
+                }
+                if (canceled->loadAcquire()) {
+                    _reader->cancel();
+                }
+            });
+        });
+        const QString importScenarioXml = importer->importScript(importParameters);
+        FormatManager::setThreadReaderSetup(FormatManager::ReaderSetup());
+        return importScenarioXml;
+    }));
+}
+
+void ImportManager::finishImport()
+{
+    //
+    // Отменённый импорт уже завершён в cancelImport
+    //
+    if (!isImportInProgress()) {
+        return;
     }
-    const QString importScenarioXml = importer->importScript(_importParameters);
 
+    const QString importScenarioXml = m_importWatcher.result();
+    const bool isImportSucceed =
+            !m_importScenario.isNull()
+            && insertImportedScript(importScenarioXml);
+
+    //
+    // Закроем уведомление
+    //
+    QWidget* parentWidget = m_importDialog->parentWidget();
+    clearImport();
+
+    //
+    // Если импорт не удался, уведомим об этом пользователя
+    //
+    if (!isImportSucceed) {
+        QLightBoxMessage::critical(parentWidget, tr("Import aborted"),
+            tr("File to import is empty. Please check that you select correct file and retry import."));
+    }
+
+    emit importFinished();
+}
+
+void ImportManager::clearImport()
+{
+    if (m_importProgress != nullptr) {
+        m_importProgress->finish();
+        m_importProgress->deleteLater();
+        m_importProgress = nullptr;
+    }
+    m_importer.reset();
+    m_importScenario.clear();
+}
+
+bool ImportManager::insertImportedScript(const QString& _importScenarioXml)
+{
     //
     // Если нету текста, прерываем выполнение
     //
-    if (importScenarioXml.isEmpty()) {
+    if (_importScenarioXml.isEmpty()) {
         return false;
     }
 
@@ -189,117 +371,58 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
     // ... определим позицию вставки
     //
     int insertPosition = 0;
-    switch (_importParameters.insertionMode) {
+    switch (m_importParameters.insertionMode) {
         case BusinessLogic::ImportParameters::ReplaceDocument: {
-            _scenario->clear();
+            m_importScenario->clear();
             insertPosition = 0;
             break;
         }
 
         case BusinessLogic::ImportParameters::ToCursorPosition: {
-            insertPosition = _cursorPosition;
+            //
+            // Пока файл разбирался, текст мог измениться, например при синхронизации
+            //
+            insertPosition = qMin(m_importCursorPosition, m_importScenario->document()->characterCount() - 1);
             break;
         }
 
         default:
         case BusinessLogic::ImportParameters::ToDocumentEnd: {
-            insertPosition = _scenario->document()->characterCount() - 1;
+            insertPosition = m_importScenario->document()->characterCount() - 1;
             break;
         }
     }
     //
     // ... загрузим текст
     //
-    _scenario->document()->insertFromMime(insertPosition, importScenarioXml);
+    m_importScenario->document()->insertFromMime(insertPosition, _importScenarioXml);
 
     //
     // ... в случае необходимости определяем локации и персонажей
     //
-    if (_importParameters.findCharactersAndLocations) {
-        //
-        // Персонажи
-        //
-        {
-            const QSet<QString> characters = QSet<QString>::fromList(_scenario->findCharacters());
-
-            //
-            // Определить персонажи, которых нет в тексте
-            //
-            QSet<QString> charactersToDelete;
-            foreach (DomainObject* domainObject,
-                     DataStorageLayer::StorageFacade::researchStorage()->characters()->toList()) {
-                Research* character = dynamic_cast<Research*>(domainObject);
-                if (!characters.contains(character->name())) {
-                    charactersToDelete.insert(character->name());
-                }
-            }
-
-            //
-            // Удалить тех, кого нет
-            //
-            DatabaseLayer::Database::transaction();
-            foreach (const QString& character, charactersToDelete) {
-                DataStorageLayer::StorageFacade::researchStorage()->removeCharacter(character);
-            }
-            DatabaseLayer::Database::commit();
-
-            //
-            // Добавить новых
-            //
-            DatabaseLayer::Database::transaction();
-            foreach (const QString& character, characters) {
-                if (!DataStorageLayer::StorageFacade::researchStorage()->hasCharacter(character)) {
-                    DataStorageLayer::StorageFacade::researchStorage()->storeCharacter(character);
-                }
-            }
-            DatabaseLayer::Database::commit();
-        }
-
-        //
-        // Локации
-        //
-        {
-            const QSet<QString> locations = QSet<QString>::fromList(_scenario->findLocations());
-
-            //
-            // Определить локации, которых нет в тексте
-            //
-            QSet<QString> locationsToDelete;
-            foreach (DomainObject* domainObject,
-                     DataStorageLayer::StorageFacade::researchStorage()->locations()->toList()) {
-                Research* location = dynamic_cast<Research*>(domainObject);
-                if (!locations.contains(location->name())) {
-                    locationsToDelete.insert(location->name());
-                }
-            }
-
-            //
-            // Удалить те, которых нет
-            //
-            DatabaseLayer::Database::transaction();
-            foreach (const QString& location, locationsToDelete) {
-                DataStorageLayer::StorageFacade::researchStorage()->removeLocation(location);
-            }
-            DatabaseLayer::Database::commit();
-
-            //
-            // Добавить новых
-            //
-            DatabaseLayer::Database::transaction();
-            foreach (const QString& location, locations) {
-                if (!DataStorageLayer::StorageFacade::researchStorage()->hasLocation(location)) {
-                    DataStorageLayer::StorageFacade::researchStorage()->storeLocation(location);
-                }
-            }
-            DatabaseLayer::Database::commit();
-        }
+    if (m_importParameters.findCharactersAndLocations) {
+        const QSet<QString> characters = QSet<QString>::fromList(m_importScenario->findCharacters());
+        const QSet<QString> locations = QSet<QString>::fromList(m_importScenario->findLocations());
+
+        //
+        // Удаляем отсутствующих в тексте и добавляем новых персонажей и локации одной транзакцией
+        //
+        auto* researchStorage = DataStorageLayer::StorageFacade::researchStorage();
+        DatabaseLayer::Database::transaction();
+        ::syncResearchNames(researchStorage->characters()->toList(), characters,
+            [researchStorage] (const QString& _name) { researchStorage->removeCharacter(_name); },
+            [researchStorage] (const QString& _name) { researchStorage->storeCharacter(_name); });
+        ::syncResearchNames(researchStorage->locations()->toList(), locations,
+            [researchStorage] (const QString& _name) { researchStorage->removeLocation(_name); },
+            [researchStorage] (const QString& _name) { researchStorage->storeLocation(_name); });
+        DatabaseLayer::Database::commit();
     }
 
 
     //
     // Загрузим данные разработки
     //
-    const QVariantMap research = importer->importResearch(_importParameters);
+    const QVariantMap research = m_importer->importResearch(m_importParameters);
     if (!research.isEmpty()) {
         //
         // Данные сценария
@@ -353,63 +476,6 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
     return true;
 }
 
-void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath)
-{
-    BusinessLogic::ImportParameters importParameters;
-    importParameters.filePath = _importFilePath;
-    importScenario(_scenario, 0, importParameters);
-}
-
-void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition)
-{
-    if (m_importDialog->exec() == QLightBoxDialog::Accepted) {
-        BusinessLogic::ImportParameters importParameters = m_importDialog->importParameters();
-
-        //
-        // Формат MS DOC не поддерживается, он отображается только для того, чтобы пользователи
-        // не теряли свои файлы
-        //
-        if (importParameters.filePath.toLower().endsWith(kMsDocExtension)) {
-            QLightBoxMessage::critical(m_importDialog, tr("File format not supported"),
-                tr("Microsoft <b>DOC</b> files are not supported. You need save it to <b>DOCX</b> file and reimport."));
-            return;
-        }
-
-        //
-        // Если файла не существует, уведомим об этом
-        //
-        if (!QFile::exists(importParameters.filePath)) {
-            QLightBoxMessage::critical(m_importDialog, tr("File doesn't exists"),
-                tr("Please choose existing file and retry import."));
-            return;
-        }
-
-        //
-        // Покажем уведомление пользователю
-        //
-        QLightBoxProgress progress(m_importDialog->parentWidget());
-        progress.showProgress(tr("Import"), tr("Please wait. Import can take few minutes."));
-
-        //
-        // Импортируем
-        //
-        const bool isImportSucceed = importScenario(_scenario, _cursorPosition, importParameters);
-
-        //
-        // Если импорт не удался, уведомим об этом пользователя
-        //
-        if (!isImportSucceed) {
-            QLightBoxMessage::critical(m_importDialog->parentWidget(), tr("Import aborted"),
-                tr("File to import is empty. Please check that you select correct file and retry import."));
-        }
-
-        //
-        // Закроем уведомление
-        //
-        progress.finish();
-    }
-}
-
 void ImportManager::initView()
 {
 
@@ -417,5 +483,8 @@ void ImportManager::initView()
 
 void ImportManager::initConnections()
 {
-
+    connect(&m_importWatcher, &QFutureWatcher<QString>::finished, this, &ImportManager::finishImport);
+    connect(this, &ImportManager::importProgressChanged, this, [] (int _progress) {
+        QLightBoxProgress::setProgressValue(_progress);
+    });
 }
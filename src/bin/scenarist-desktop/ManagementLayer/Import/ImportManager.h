@@ -1,11 +1,18 @@
 #ifndef IMPORTMANAGER_H
 #define IMPORTMANAGER_H
 
+#include <BusinessLayer/Import/AbstractImporter.h>
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
 #include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+
+class QLightBoxProgress;
 
 namespace BusinessLogic {
     class ScenarioDocument;
-    class ImportParameters;
 }
 
 namespace UserInterface {
@@ -24,18 +31,64 @@ namespace ManagementLayer
 
     public:
         explicit ImportManager(QObject* _parent, QWidget* _parentWidget);
+        ~ImportManager();
 
         /**
          * @brief Импортировать сценарий
+         * @note Файл разбирается в фоновом потоке, а текст вставляется в сценарий после
+         *       завершения разбора, о чём сообщает сигнал importFinished
          */
         /** @{ */
-        bool importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
-            const BusinessLogic::ImportParameters& _importParameters);
         void importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath);
         void importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition);
         /** @} */
 
+        /**
+         * @brief Выполняется ли импорт в данный момент
+         */
+        bool isImportInProgress() const;
+
+        /**
+         * @brief Прервать выполняющийся импорт, не изменяя сценарий
+         * @note Дожидается завершения фонового разбора, сигнал importFinished не испускается
+         */
+        void cancelImport();
+
+    signals:
+        /**
+         * @brief Импорт завершён, текст и данные разработки добавлены в проект
+         */
+        void importFinished();
+
+        /**
+         * @brief Изменился прогресс разбора импортируемого файла, в процентах
+         * @note Испускается из фонового потока
+         */
+        void importProgressChanged(int _progress);
+
     private:
+        /**
+         * @brief Запустить разбор импортируемого сценария в фоновом потоке
+         */
+        void startImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+            const BusinessLogic::ImportParameters& _importParameters);
+
+        /**
+         * @brief Обработать завершение фонового разбора
+         */
+        void finishImport();
+
+        /**
+         * @brief Вставить разобранный сценарий в документ и загрузить данные разработки
+         * @return false, если импортируемый сценарий пуст
+         */
+        bool insertImportedScript(const QString& _importScenarioXml);
+
+        /**
+         * @brief Освободить данные завершённого импорта
+         */
+        void clearImport();
+
         /**
          * @brief Настроить представление
          */
@@ -51,6 +104,41 @@ namespace ManagementLayer
          * @brief Диалог экспорта
          */
         UserInterface::ImportDialog* m_importDialog;
+
+        /**
+         * @brief Наблюдатель за фоновым разбором импортируемого сценария
+         */
+        QFutureWatcher<QString> m_importWatcher;
+
+        /**
+         * @brief Импортёр выполняющегося импорта
+         */
+        QScopedPointer<BusinessLogic::AbstractImporter> m_importer;
+
+        /**
+         * @brief Параметры выполняющегося импорта
+         */
+        BusinessLogic::ImportParameters m_importParameters;
+
+        /**
+         * @brief Сценарий, в который выполняется импорт
+         */
+        QPointer<BusinessLogic::ScenarioDocument> m_importScenario;
+
+        /**
+         * @brief Позиция курсора в сценарии на момент начала импорта
+         */
+        int m_importCursorPosition = 0;
+
+        /**
+         * @brief Флаг отмены импорта, общий с фоновым потоком
+         */
+        QSharedPointer<QAtomicInt> m_importCanceled;
+
+        /**
+         * @brief Уведомление о выполняющемся импорте
+         */
+        QLightBoxProgress* m_importProgress = nullptr;
     };
 }
 
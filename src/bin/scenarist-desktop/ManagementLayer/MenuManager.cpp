@@ -9,7 +9,7 @@
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxmessage.h>
 #include <3rd_party/Widgets/WAF/Animation/Animation.h>
 
-#include <NetworkRequestLoader.h>
+#include <NetworkRequest.h>
 
 #include <QCryptographicHash>
 #include <QTimer>
@@ -106,7 +106,11 @@ void MenuManager::completeLogin(const QString& _userName, const QString& _userEm
     //
     const QString emailHash = QCryptographicHash::hash(_userEmail.toLower().toUtf8(), QCryptographicHash::Md5).toHex();
     const QString avatarUrl = QString("https://www.gravatar.com/avatar/%1?s=45&d=404").arg(emailHash);
-    NetworkRequestLoader::loadAsync(avatarUrl, [this] (const QByteArray& _avatarData) {
+    NetworkRequest* avatarLoader = new NetworkRequest(this);
+    avatarLoader->setPriority(NetworkRequestPriority::Low);
+    avatarLoader->setCacheEnabled(true);
+    connect(avatarLoader, &NetworkRequest::finished, avatarLoader, &NetworkRequest::deleteLater);
+    connect(avatarLoader, &NetworkRequest::downloadComplete, this, [this] (const QByteArray& _avatarData) {
         QPixmap avatar;
         //
         // Если аватар не найден используем стандартную аватарку
@@ -123,6 +127,7 @@ void MenuManager::completeLogin(const QString& _userName, const QString& _userEm
         }
         m_view->setAvatar(avatar);
     });
+    avatarLoader->loadAsync(avatarUrl);
 }
 
 QString MenuManager::userEmail() const
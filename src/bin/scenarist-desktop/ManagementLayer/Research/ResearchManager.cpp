@@ -40,6 +40,34 @@ namespace {
      * @brief Флаг загрузки проекта
      */
     static bool g_isProjectLoading = false;
+
+    /**
+     * @brief Сохранить значение данных сценария с заданным ключом
+     */
+    static void saveScenarioDataValue(const QString& _key, const QString& _value) {
+        auto* storage = StorageFacade::scenarioDataStorage();
+        if (_key == ScenarioData::NAME_KEY) {
+            storage->setName(_value);
+        } else if (_key == ScenarioData::SCENE_NUMBERS_PREFIX_KEY) {
+            storage->setSceneNumbersPrefix(_value);
+        } else if (_key == ScenarioData::SCENE_START_NUMBER_KEY) {
+            storage->setSceneStartNumber(_value);
+        } else if (_key == ScenarioData::ADDITIONAL_INFO_KEY) {
+            storage->setAdditionalInfo(_value);
+        } else if (_key == ScenarioData::GENRE_KEY) {
+            storage->setGenre(_value);
+        } else if (_key == ScenarioData::AUTHOR_KEY) {
+            storage->setAuthor(_value);
+        } else if (_key == ScenarioData::CONTACTS_KEY) {
+            storage->setContacts(_value);
+        } else if (_key == ScenarioData::YEAR_KEY) {
+            storage->setYear(_value);
+        } else if (_key == ScenarioData::LOGLINE_KEY) {
+            storage->setLogline(_value);
+        } else if (_key == ScenarioData::SYNOPSIS_KEY) {
+            storage->setSynopsis(_value);
+        }
+    }
 }
 
 
@@ -49,7 +77,9 @@ ResearchManager::ResearchManager(QObject* _parent, QWidget* _parentWidget) :
     m_dialog(new ResearchItemDialog(m_view)),
     m_model(new ResearchModel(this)),
     m_currentResearchItem(0),
-    m_currentResearch(0)
+    m_currentResearch(0),
+    m_isAllResearchChanged(false),
+    m_lastSavedRowsCount(0)
 {
     initView();
     initConnections();
@@ -88,6 +118,12 @@ void ResearchManager::loadCurrentProject()
     m_view->selectItem(m_model->index(0, 0));
     editResearch(m_model->index(0, 0));
 
+    //
+    // Только что загруженные данные не требуют сохранения
+    //
+    m_changedResearch.clear();
+    m_isAllResearchChanged = false;
+
     g_isProjectLoading = false;
 }
 
@@ -103,6 +139,7 @@ void ResearchManager::loadScenarioData()
     m_scenarioData.insert(ScenarioData::YEAR_KEY, StorageFacade::scenarioDataStorage()->year());
     m_scenarioData.insert(ScenarioData::LOGLINE_KEY, StorageFacade::scenarioDataStorage()->logline());
     m_scenarioData.insert(ScenarioData::SYNOPSIS_KEY, StorageFacade::scenarioDataStorage()->synopsis());
+    m_changedScenarioDataKeys.clear();
 
     if (m_view->currentResearchIndex().isValid()) {
         editResearch(m_view->currentResearchIndex());
@@ -124,6 +161,9 @@ void ResearchManager::loadCurrentProjectSettings(const QString& _projectPath)
 void ResearchManager::closeCurrentProject()
 {
     m_scenarioData.clear();
+    m_changedScenarioDataKeys.clear();
+    m_changedResearch.clear();
+    m_isAllResearchChanged = false;
     m_model->clear();
     m_view->clear();
 }
@@ -170,30 +210,48 @@ void ResearchManager::updateSettings()
 
 void ResearchManager::saveResearch()
 {
+    m_lastSavedRowsCount = 0;
+
     //
-    // Сохраняем данные сценария
+    // Сохраняем изменённые данные сценария
     //
     if (!m_scenarioData.isEmpty()) {
-        StorageFacade::scenarioDataStorage()->setName(m_scenarioData.value(ScenarioData::NAME_KEY));
-        StorageFacade::scenarioDataStorage()->setSceneNumbersPrefix(m_scenarioData.value(ScenarioData::SCENE_NUMBERS_PREFIX_KEY));
-        StorageFacade::scenarioDataStorage()->setSceneStartNumber(m_scenarioData.value(ScenarioData::SCENE_START_NUMBER_KEY));
-        StorageFacade::scenarioDataStorage()->setAdditionalInfo(m_scenarioData.value(ScenarioData::ADDITIONAL_INFO_KEY));
-        StorageFacade::scenarioDataStorage()->setGenre(m_scenarioData.value(ScenarioData::GENRE_KEY));
-        StorageFacade::scenarioDataStorage()->setAuthor(m_scenarioData.value(ScenarioData::AUTHOR_KEY));
-        StorageFacade::scenarioDataStorage()->setContacts(m_scenarioData.value(ScenarioData::CONTACTS_KEY));
-        StorageFacade::scenarioDataStorage()->setYear(m_scenarioData.value(ScenarioData::YEAR_KEY));
-        StorageFacade::scenarioDataStorage()->setLogline(m_scenarioData.value(ScenarioData::LOGLINE_KEY));
-        StorageFacade::scenarioDataStorage()->setSynopsis(m_scenarioData.value(ScenarioData::SYNOPSIS_KEY));
+        foreach (const QString& key, m_changedScenarioDataKeys) {
+            ::saveScenarioDataValue(key, m_scenarioData.value(key));
+            ++m_lastSavedRowsCount;
+        }
     }
+    m_changedScenarioDataKeys.clear();
 
     //
-    // Сохраняем элементы разработки
+    // Сохраняем изменённые элементы разработки
     //
-    foreach (Domain::DomainObject* researchObject,
-             DataStorageLayer::StorageFacade::researchStorage()->all()->toList()) {
-        Domain::Research* research = dynamic_cast<Domain::Research*>(researchObject);
-        DataStorageLayer::StorageFacade::researchStorage()->updateResearch(research);
+    // NOTE: Проходим по актуальному списку из хранилища, а не по набору изменённых элементов,
+    //       т.к. элементы могли быть удалены из хранилища в обход управляющего
+    //
+    if (m_isAllResearchChanged || !m_changedResearch.isEmpty()) {
+        foreach (Domain::DomainObject* researchObject,
+                 DataStorageLayer::StorageFacade::researchStorage()->all()->toList()) {
+            Domain::Research* research = dynamic_cast<Domain::Research*>(researchObject);
+            if (m_isAllResearchChanged || m_changedResearch.contains(research)) {
+                DataStorageLayer::StorageFacade::researchStorage()->updateResearch(research);
+                ++m_lastSavedRowsCount;
+            }
+        }
     }
+    m_changedResearch.clear();
+    m_isAllResearchChanged = false;
+}
+
+void ResearchManager::markAllResearchChanged()
+{
+    m_changedScenarioDataKeys = m_scenarioData.keys().toSet();
+    m_isAllResearchChanged = true;
+}
+
+int ResearchManager::lastSavedRowsCount() const
+{
+    return m_lastSavedRowsCount;
 }
 
 void ResearchManager::setCommentOnly(bool _isCommentOnly)
@@ -330,7 +388,9 @@ void ResearchManager::addResearch(const QModelIndex& _selectedItemIndex, int _ty
             // Обновляем порядок сортировки
             //
             for (int row = 0; row < parentResearchItem->childCount(); ++row) {
-                parentResearchItem->childAt(row)->research()->setSortOrder(row);
+                Research* childResearch = parentResearchItem->childAt(row)->research();
+                childResearch->setSortOrder(row);
+                markResearchChanged(childResearch);
             }
 
             QModelIndex indexForSelect;
@@ -519,6 +579,7 @@ void ResearchManager::removeResearchItem(BusinessLogic::ResearchModelItem* _item
     //
     // Удалим
     //
+    m_changedResearch.remove(_item->research());
     DataStorageLayer::StorageFacade::researchStorage()->removeResearch(_item->research());
 }
 
@@ -626,9 +687,11 @@ void ResearchManager::showNavigatorContextMenu(const QModelIndex& _index, const
             refreshResearchSubtree(_index);
         } else if (toggledAction == removeColorAction) {
             researchItem->research()->setColor(QColor());
+            markResearchChanged(researchItem->research());
         } else {
             if (colorsPane->currentColor().isValid()) {
                 researchItem->research()->setColor(colorsPane->currentColor());
+                markResearchChanged(researchItem->research());
             }
         }
     }
@@ -643,10 +706,18 @@ void ResearchManager::updateScenarioData(const QString& _key, const QString& _va
         && m_scenarioData.contains(_key)
         && m_scenarioData.value(_key) != _value) {
         m_scenarioData.insert(_key, _value);
+        m_changedScenarioDataKeys.insert(_key);
         emit researchChanged();
     }
 }
 
+void ResearchManager::markResearchChanged(Domain::Research* _research)
+{
+    if (_research != nullptr) {
+        m_changedResearch.insert(_research);
+    }
+}
+
 void ResearchManager::initView()
 {
     m_view->setResearchModel(m_model);
@@ -655,6 +726,11 @@ void ResearchManager::initView()
 void ResearchManager::initConnections()
 {
     connect(m_model, &ResearchModel::itemMoved, this, [this] (const QModelIndex& _index) {
+        //
+        // При перемещении меняются порядки сортировки элементов и в старом и в новом родителе,
+        // поэтому при следующем сохранении сохраняем всё дерево
+        //
+        m_isAllResearchChanged = true;
         m_view->selectItem(_index);
         emit researchChanged();
     });
@@ -727,6 +803,7 @@ void ResearchManager::initConnections()
             if (StorageFacade::researchStorage()->hasCharacter(_name)) {
                 Research* mainCharacter = StorageFacade::researchStorage()->character(_name);
                 mainCharacter->addDescription(m_currentResearch->description());
+                markResearchChanged(mainCharacter);
                 removeResearchItem(m_currentResearchItem);
             }
             //
@@ -734,6 +811,7 @@ void ResearchManager::initConnections()
             //
             else {
                 m_currentResearch->setName(newName);
+                markResearchChanged(m_currentResearch);
                 m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             }
             emit researchChanged();
@@ -745,6 +823,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Character) {
             auto* researchCharacter = dynamic_cast<ResearchCharacter*>(m_currentResearch);
             researchCharacter->setRealName(_name);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -753,6 +832,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Character) {
             auto* researchCharacter = dynamic_cast<ResearchCharacter*>(m_currentResearch);
             researchCharacter->setDescriptionText(_description);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -771,6 +851,7 @@ void ResearchManager::initConnections()
             if (StorageFacade::researchStorage()->hasLocation(_name)) {
                 Research* mainLocation = StorageFacade::researchStorage()->location(_name);
                 mainLocation->addDescription(m_currentResearch->description());
+                markResearchChanged(mainLocation);
                 removeResearchItem(m_currentResearchItem);
             }
             //
@@ -778,6 +859,7 @@ void ResearchManager::initConnections()
             //
             else {
                 m_currentResearch->setName(newName);
+                markResearchChanged(m_currentResearch);
                 m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             }
             emit researchChanged();
@@ -789,6 +871,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Location
             && m_currentResearch->description() != _description) {
             m_currentResearch->setDescription(_description);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -801,6 +884,7 @@ void ResearchManager::initConnections()
                 || m_currentResearch->type() == Research::Text)
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -811,6 +895,7 @@ void ResearchManager::initConnections()
                 || m_currentResearch->type() == Research::Text)
             && m_currentResearch->description() != _description) {
             m_currentResearch->setDescription(_description);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -822,6 +907,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -831,6 +917,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->url() != _urlLink) {
             m_currentResearch->setUrl(_urlLink);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -840,6 +927,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->description() != _html) {
             m_currentResearch->setDescription(_html);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -851,6 +939,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::ImagesGallery
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -865,6 +954,7 @@ void ResearchManager::initConnections()
                 StorageFacade::researchStorage()->storeResearch(
                     m_currentResearch, Research::Image, _sortOrder, tr("Unnamed image"));
             newResearch->setImage(_image);
+            markResearchChanged(newResearch);
 
             emit researchChanged();
         }
@@ -880,6 +970,7 @@ void ResearchManager::initConnections()
             //
             // ... удалим
             //
+            m_changedResearch.remove(researchToDelete);
             DataStorageLayer::StorageFacade::researchStorage()->removeResearch(researchToDelete);
 
             //
@@ -888,6 +979,7 @@ void ResearchManager::initConnections()
             for (int childIndex = _sortOrder; childIndex < m_currentResearchItem->childCount(); ++childIndex) {
                 Research* research = m_currentResearchItem->childAt(childIndex)->research();
                 research->setSortOrder(research->sortOrder() - 1);
+                markResearchChanged(research);
             }
         }
     });
@@ -899,6 +991,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Image
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -907,6 +1000,7 @@ void ResearchManager::initConnections()
         if (m_currentResearch != nullptr
             && m_currentResearch->type() == Research::Image) {
             m_currentResearch->setImage(_image);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -918,6 +1012,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::MindMap
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -926,6 +1021,7 @@ void ResearchManager::initConnections()
         if (m_currentResearch != nullptr
             && m_currentResearch->type() == Research::MindMap) {
             m_currentResearch->setDescription(_xml);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QSet>
 
 class QAbstractItemModel;
 
@@ -75,9 +76,21 @@ namespace ManagementLayer
 
         /**
          * @brief Сохранить разработки проекта
+         * @note Сохраняются только изменённые с момента последнего сохранения данные
          */
         void saveResearch();
 
+        /**
+         * @brief Пометить все данные разработки как изменённые
+         * @note Используется, когда предыдущее сохранение завершилось ошибкой
+         */
+        void markAllResearchChanged();
+
+        /**
+         * @brief Получить количество записей, сохранённых при последнем сохранении
+         */
+        int lastSavedRowsCount() const;
+
         /**
          * @brief Установить режим работы со сценарием
          */
@@ -188,6 +201,11 @@ namespace ManagementLayer
          */
         void updateScenarioData(const QString& _key, const QString& _value);
 
+        /**
+         * @brief Пометить элемент разработки как изменённый
+         */
+        void markResearchChanged(Domain::Research* _research);
+
     private:
         /**
          * @brief Настроить представление
@@ -215,6 +233,28 @@ namespace ManagementLayer
          */
         QMap<QString, QString> m_scenarioData;
 
+        /**
+         * @brief Ключи данных сценария, изменённые с момента последнего сохранения
+         */
+        QSet<QString> m_changedScenarioDataKeys;
+
+        /**
+         * @brief Элементы разработки, изменённые с момента последнего сохранения
+         */
+        QSet<Domain::Research*> m_changedResearch;
+
+        /**
+         * @brief Нужно ли сохранить все элементы разработки
+         * @note Используется, когда невозможно точно определить изменённые элементы,
+         *       например при перемещении элементов в дереве
+         */
+        bool m_isAllResearchChanged;
+
+        /**
+         * @brief Количество записей, сохранённых при последнем сохранении
+         */
+        int m_lastSavedRowsCount;
+
         /**
          * @brief Модель данных о разработке
          */
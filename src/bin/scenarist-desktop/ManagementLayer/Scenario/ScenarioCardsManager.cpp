@@ -30,6 +30,22 @@ using UserInterface::ScenarioSchemeItemDialog;
 namespace {
     const bool IS_DRAFT = true;
     const bool IS_SCRIPT = false;
+
+    /**
+     * @brief Заголовок карточки для элемента модели
+     */
+    static QString cardTitle(const BusinessLogic::ScenarioModelItem* _item) {
+        return _item->title().isEmpty()
+                ? TextEditHelper::smartToUpper(_item->header())
+                : TextEditHelper::smartToUpper(_item->title());
+    }
+
+    /**
+     * @brief Описание карточки для элемента модели
+     */
+    static QString cardDescription(const BusinessLogic::ScenarioModelItem* _item) {
+        return _item->description().isEmpty() ? _item->fullText() : _item->description();
+    }
 }
 
 
@@ -39,6 +55,14 @@ ScenarioCardsManager::ScenarioCardsManager(QObject* _parent, QWidget* _parentWid
     m_addItemDialog(new ScenarioSchemeItemDialog(_parentWidget)),
     m_printDialog(new PrintCardsDialog(_parentWidget))
 {
+    //
+    // Операции над карточками применяются один раз за проход цикла событий,
+    // чтобы правка текста не приводила к перестроению схемы на каждый символ
+    //
+    m_cardOperationsTimer.setSingleShot(true);
+    m_cardOperationsTimer.setInterval(0);
+    connect(&m_cardOperationsTimer, &QTimer::timeout, this, &ScenarioCardsManager::applyCardOperations);
+
     initConnections();
     reloadSettings();
 }
@@ -79,6 +103,7 @@ QString ScenarioCardsManager::save() const
 
 void ScenarioCardsManager::saveChanges(bool _hasChangesInText)
 {
+    applyCardOperations();
     m_view->saveChanges(_hasChangesInText);
 }
 
@@ -124,21 +149,9 @@ void ScenarioCardsManager::load(BusinessLogic::ScenarioModel* _model, const QStr
                 BusinessLogic::ScenarioModelItem* currentCard = m_model->itemForIndex(currentCardIndex);
 
                 //
-                // ... вставляем
+                // ... ставим вставку в очередь, данные карточки будут взяты из модели при применении
                 //
-                const bool isEmbedded =
-                        item->hasParent()
-                        && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
-                m_view->insertCard(
-                    item->uuid(),
-                    item->type() == BusinessLogic::ScenarioModelItem::Folder,
-                    item->sceneNumber(),
-                    item->title().isEmpty() ? TextEditHelper::smartToUpper(item->header()) : TextEditHelper::smartToUpper(item->title()),
-                    item->description().isEmpty() ? item->fullText() : item->description(),
-                    item->stamp(),
-                    item->colors(),
-                    isEmbedded,
-                    currentCard->uuid());
+                scheduleCardOperation(CardOperation::Insert, item->uuid(), currentCard->uuid());
             }
         });
         connect(m_model, &BusinessLogic::ScenarioModel::rowsAboutToBeRemoved, this, [this] (const QModelIndex& _parent, int _first, int _last) {
@@ -150,45 +163,23 @@ void ScenarioCardsManager::load(BusinessLogic::ScenarioModel* _model, const QStr
                     currentCardIndex = m_model->index(row, 0);
                 }
                 BusinessLogic::ScenarioModelItem* currentCard = m_model->itemForIndex(currentCardIndex);
-                m_view->removeCard(currentCard->uuid());
+                scheduleCardOperation(CardOperation::Remove, currentCard->uuid());
             }
         });
         connect(m_model, &BusinessLogic::ScenarioModel::dataChanged, this, [this] (const QModelIndex& _topLeft, const QModelIndex& _bottomRight) {
             for (int row = _topLeft.row(); row <= _bottomRight.row(); ++row) {
                 const QModelIndex index = m_model->index(row, 0, _topLeft.parent());
                 const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(index);
-                //
-                // Если тип карточки определить не удалось, удаляем её
-                //
-                if (item->type() == BusinessLogic::ScenarioModelItem::Undefined) {
-                    m_view->removeCard(item->uuid());
-                }
-                //
-                // А если тип нормальный, то обновляем данные о карточке
-                //
-                else {
-                    const bool isAct =
-                            item->type() == BusinessLogic::ScenarioModelItem::Folder
-                            && item->hasParent()
-                            && item->parent()->type() == BusinessLogic::ScenarioModelItem::Scenario;
-                    const bool isEmbedded =
-                            item->hasParent()
-                            && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
-                    m_view->updateCard(
-                        item->uuid(),
-                        item->type() == BusinessLogic::ScenarioModelItem::Folder,
-                        item->sceneNumber(),
-                        item->title().isEmpty() ? TextEditHelper::smartToUpper(item->header()) : TextEditHelper::smartToUpper(item->title()),
-                        item->description().isEmpty() ? item->fullText() : item->description(),
-                        item->stamp(),
-                        item->colors(),
-                        isEmbedded,
-                        isAct);
-                }
+                scheduleCardOperation(CardOperation::Update, item->uuid());
             }
         });
     }
 
+    //
+    // Операции, накопленные для предыдущей схемы, больше не актуальны
+    //
+    dropCardOperations();
+
     //
     // Загрузим сценарий
     //
@@ -211,16 +202,19 @@ void ScenarioCardsManager::clear()
         m_model->disconnect(this);
         m_model = nullptr;
     }
+    dropCardOperations();
     m_view->clear();
 }
 
 void ScenarioCardsManager::undo()
 {
+    applyCardOperations();
     m_view->undo();
 }
 
 void ScenarioCardsManager::redo()
 {
+    applyCardOperations();
     m_view->redo();
 }
 
@@ -669,6 +663,172 @@ void ScenarioCardsManager::printCards(QPrinter* _printer)
     m_printDialog->setEnabled(true);
 }
 
+void ScenarioCardsManager::scheduleCardOperation(CardOperation::Type _type, const QString& _uuid,
+    const QString& _previousCardUuid)
+{
+    switch (_type) {
+        case CardOperation::Insert: {
+            m_pendingCardOperations.append({ _type, _uuid, _previousCardUuid });
+            m_pendingCardUuids.insert(_uuid);
+            break;
+        }
+
+        case CardOperation::Update: {
+            //
+            // Если карточка уже ожидает вставки или обновления, то её данные и так
+            // будут прочитаны из модели при применении операций
+            //
+            if (m_pendingCardUuids.contains(_uuid)) {
+                return;
+            }
+            m_pendingCardOperations.append({ _type, _uuid, _previousCardUuid });
+            m_pendingCardUuids.insert(_uuid);
+            break;
+        }
+
+        case CardOperation::Remove: {
+            //
+            // Если карточка ещё не попала в представление, то просто забываем о ней.
+            // Ожидающие операции ищем только для карточек из набора ожидающих,
+            // чтобы удаление большого фрагмента не просматривало очередь на каждую строку
+            //
+            bool isInsertPending = false;
+            const bool hasPendingOperations = m_pendingCardUuids.contains(_uuid);
+            for (int index = m_pendingCardOperations.size() - 1; hasPendingOperations && index >= 0; --index) {
+                const CardOperation& operation = m_pendingCardOperations.at(index);
+                if (operation.uuid != _uuid) {
+                    continue;
+                }
+                if (operation.type == CardOperation::Remove) {
+                    break;
+                }
+                if (operation.type == CardOperation::Insert) {
+                    isInsertPending = true;
+                }
+            }
+            if (isInsertPending) {
+                QString insertPreviousCardUuid;
+                for (int index = m_pendingCardOperations.size() - 1; index >= 0; --index) {
+                    const CardOperation& operation = m_pendingCardOperations.at(index);
+                    if (operation.uuid != _uuid) {
+                        continue;
+                    }
+                    if (operation.type == CardOperation::Remove) {
+                        break;
+                    }
+                    if (operation.type == CardOperation::Insert) {
+                        insertPreviousCardUuid = operation.previousCardUuid;
+                    }
+                    m_pendingCardOperations.removeAt(index);
+                }
+
+                //
+                // Карточки, которые должны были встать после отменённой, ставим на её место
+                //
+                for (CardOperation& operation : m_pendingCardOperations) {
+                    if (operation.type == CardOperation::Insert
+                        && operation.previousCardUuid == _uuid) {
+                        operation.previousCardUuid = insertPreviousCardUuid;
+                    }
+                }
+            } else {
+                m_pendingCardOperations.append({ _type, _uuid, _previousCardUuid });
+            }
+            m_pendingCardUuids.remove(_uuid);
+            break;
+        }
+    }
+
+    if (!m_cardOperationsTimer.isActive()) {
+        m_cardOperationsTimer.start();
+    }
+}
+
+void ScenarioCardsManager::applyCardOperations()
+{
+    if (m_pendingCardOperations.isEmpty()
+        || m_model == nullptr) {
+        return;
+    }
+
+    //
+    // Забираем очередь целиком, чтобы изменения во время применения попали в следующий пакет
+    //
+    QList<CardOperation> operations;
+    operations.swap(m_pendingCardOperations);
+    m_pendingCardUuids.clear();
+
+    const bool updatesEnabled = m_view->updatesEnabled();
+    m_view->setUpdatesEnabled(false);
+
+    for (const CardOperation& operation : operations) {
+        if (operation.type == CardOperation::Remove) {
+            m_view->removeCard(operation.uuid);
+            continue;
+        }
+
+        //
+        // Данные вставляемых и обновляемых карточек берём из модели на момент применения,
+        // так каждая карточка обсчитывается один раз, сколько бы правок ни было в пакете
+        //
+        const QModelIndex index = m_model->indexForUuid(operation.uuid);
+        if (!index.isValid()) {
+            continue;
+        }
+        const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(index);
+        const bool isEmbedded =
+                item->hasParent()
+                && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
+
+        if (operation.type == CardOperation::Insert) {
+            m_view->insertCard(
+                item->uuid(),
+                item->type() == BusinessLogic::ScenarioModelItem::Folder,
+                item->sceneNumber(),
+                cardTitle(item),
+                cardDescription(item),
+                item->stamp(),
+                item->colors(),
+                isEmbedded,
+                operation.previousCardUuid);
+        }
+        //
+        // Если тип карточки определить не удалось, удаляем её
+        //
+        else if (item->type() == BusinessLogic::ScenarioModelItem::Undefined) {
+            m_view->removeCard(item->uuid());
+        }
+        //
+        // А если тип нормальный, то обновляем данные о карточке
+        //
+        else {
+            const bool isAct =
+                    item->type() == BusinessLogic::ScenarioModelItem::Folder
+                    && item->hasParent()
+                    && item->parent()->type() == BusinessLogic::ScenarioModelItem::Scenario;
+            m_view->updateCard(
+                item->uuid(),
+                item->type() == BusinessLogic::ScenarioModelItem::Folder,
+                item->sceneNumber(),
+                cardTitle(item),
+                cardDescription(item),
+                item->stamp(),
+                item->colors(),
+                isEmbedded,
+                isAct);
+        }
+    }
+
+    m_view->setUpdatesEnabled(updatesEnabled);
+}
+
+void ScenarioCardsManager::dropCardOperations()
+{
+    m_cardOperationsTimer.stop();
+    m_pendingCardOperations.clear();
+    m_pendingCardUuids.clear();
+}
+
 void ScenarioCardsManager::initConnections()
 {
     //
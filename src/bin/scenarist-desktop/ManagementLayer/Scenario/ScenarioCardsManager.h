@@ -3,6 +3,8 @@
 
 #include <QModelIndexList>
 #include <QObject>
+#include <QSet>
+#include <QTimer>
 
 class QPrinter;
 
@@ -43,8 +45,14 @@ namespace ManagementLayer
          */
         void reloadSettings();
 
+        /**
+         * @brief Применить накопленные операции над карточками к представлению одним пакетом
+         */
+        void applyCardOperations();
+
         /**
          * @brief Сохранить схему сценария
+         * @note Накопленные операции над карточками должны быть предварительно применены
          */
         QString save() const;
 
@@ -192,6 +200,44 @@ namespace ManagementLayer
          */
         void initConnections();
 
+        /**
+         * @brief Операция над карточкой, ожидающая применения к представлению
+         */
+        struct CardOperation {
+            enum Type {
+                Insert,
+                Update,
+                Remove
+            };
+
+            /**
+             * @brief Тип операции
+             */
+            Type type;
+
+            /**
+             * @brief Идентификатор карточки
+             */
+            QString uuid;
+
+            /**
+             * @brief Идентификатор карточки, после которой нужно вставить новую
+             */
+            QString previousCardUuid;
+        };
+
+        /**
+         * @brief Поставить операцию в очередь на применение к представлению
+         * @note Повторные обновления одной и той же карточки схлопываются в одно
+         */
+        void scheduleCardOperation(CardOperation::Type _type, const QString& _uuid,
+            const QString& _previousCardUuid = QString());
+
+        /**
+         * @brief Сбросить накопленные операции без применения
+         */
+        void dropCardOperations();
+
     private:
         /**
          * @brief Представление редактора карт
@@ -217,6 +263,21 @@ namespace ManagementLayer
          * @brief Модель сценария
          */
         BusinessLogic::ScenarioModel* m_model = nullptr;
+
+        /**
+         * @brief Операции над карточками, накопленные за текущий проход цикла событий
+         */
+        QList<CardOperation> m_pendingCardOperations;
+
+        /**
+         * @brief Карточки, данные которых будут перечитаны из модели при применении операций
+         */
+        QSet<QString> m_pendingCardUuids;
+
+        /**
+         * @brief Таймер применения накопленных операций
+         */
+        QTimer m_cardOperationsTimer;
     };
 }
 
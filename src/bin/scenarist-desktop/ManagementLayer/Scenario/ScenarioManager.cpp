@@ -29,6 +29,8 @@
 #include <DataLayer/DataStorageLayer/ResearchStorage.h>
 #include <DataLayer/DataStorageLayer/SettingsStorage.h>
 
+#include <ManagementLayer/Project/ProjectsManager.h>
+
 #include <3rd_party/Helpers/DiffMatchPatchHelper.h>
 #include <3rd_party/Helpers/ShortcutHelper.h>
 #include <3rd_party/Widgets/FlatButton/FlatButton.h>
@@ -37,6 +39,7 @@
 
 #include <QApplication>
 #include <QComboBox>
+#include <QDebug>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QTextCursor>
@@ -48,6 +51,8 @@
 #include <QStackedWidget>
 #include <QWidget>
 
+#include <algorithm>
+
 using ManagementLayer::ScenarioManager;
 using ManagementLayer::ScenarioCardsManager;
 using ManagementLayer::ScenarioNavigatorManager;
@@ -80,6 +85,89 @@ namespace {
     const int FAST_SAVE_CHANGES_INTERVAL = 1000;
     /** @} */
 
+    /**
+     * @brief Ключ для хранения в проекте идентификатора последнего изменения, вошедшего в снимок
+     *        текста сценария, пустой, если снимок содержит все изменения
+     */
+    const QString SNAPSHOT_LAST_CHANGE_KEY = "script-snapshot-last-change";
+
+    /**
+     * @brief Значение ключа снимка, когда в него не вошло ни одного изменения
+     */
+    const QString SNAPSHOT_WITHOUT_CHANGES = "none";
+
+    /**
+     * @brief Ключ для хранения в проекте ревизии сценария, которой соответствует схема карточек
+     */
+    const QString CARDS_SCHEME_REVISION_KEY = "cards-scheme-revision";
+
+    /**
+     * @brief Количество инкрементальных сохранений, после которого сохраняется полный снимок текста
+     */
+    const int SAVES_BETWEEN_SNAPSHOTS = 50;
+
+    /**
+     * @brief Включён ли режим инкрементального сохранения текста сценария
+     * @note Для проектов из облака всегда сохраняется полный текст, т.к. синхронизация может
+     *       добавлять изменения не в хронологическом порядке
+     */
+    static bool isIncrementalSaveEnabled() {
+        return DataStorageLayer::StorageFacade::settingsStorage()->value(
+                    "application/incremental-save",
+                    DataStorageLayer::SettingsStorage::ApplicationSettings).toInt()
+                && !ManagementLayer::ProjectsManager::currentProject().isRemote();
+    }
+
+    /**
+     * @brief Получить идентификатор последнего изменения сценария
+     */
+    static QString lastChangeUuid() {
+        const Domain::ScenarioChange* lastChange =
+                DataStorageLayer::StorageFacade::scenarioChangeStorage()->last();
+        return lastChange != nullptr ? lastChange->uuid().toString() : SNAPSHOT_WITHOUT_CHANGES;
+    }
+
+    /**
+     * @brief Собрать патчи изменений, следующих за последним вошедшим в снимок текста
+     * @param _onlyStored - брать только изменения, уже записанные в базу данных
+     * @return false, если изменения, вошедшего в снимок, нет в журнале, в этом случае
+     *         неизвестно, какие изменения применять, и патчи не собираются
+     * @note Изменения упорядочиваются явно по времени и идентификатору, т.к. хранилище
+     *       не гарантирует хронологического порядка
+     */
+    static bool collectPatchesSinceSnapshot(const QString& _snapshotLastChangeUuid, bool _onlyStored,
+        QList<QString>& _patches, QList<QString>& _draftPatches) {
+        QList<Domain::ScenarioChange*> changes;
+        foreach (DomainObject* domainObject,
+                 DataStorageLayer::StorageFacade::scenarioChangeStorage()->all()->toList()) {
+            Domain::ScenarioChange* change = dynamic_cast<Domain::ScenarioChange*>(domainObject);
+            if (!_onlyStored || change->id().isValid()) {
+                changes.append(change);
+            }
+        }
+        std::stable_sort(changes.begin(), changes.end(),
+                         [] (const Domain::ScenarioChange* _lhs, const Domain::ScenarioChange* _rhs) {
+            if (_lhs->datetime() != _rhs->datetime()) {
+                return _lhs->datetime() < _rhs->datetime();
+            }
+            return _lhs->id().value() < _rhs->id().value();
+        });
+
+        bool isAfterSnapshot = _snapshotLastChangeUuid == SNAPSHOT_WITHOUT_CHANGES;
+        for (const Domain::ScenarioChange* change : changes) {
+            if (isAfterSnapshot) {
+                if (change->isDraft()) {
+                    _draftPatches.append(change->redoPatch());
+                } else {
+                    _patches.append(change->redoPatch());
+                }
+            } else if (change->uuid().toString() == _snapshotLastChangeUuid) {
+                isAfterSnapshot = true;
+            }
+        }
+        return isAfterSnapshot;
+    }
+
     /**
      * @brief Индексы дополнительных панелей в навигаторе
      */
@@ -363,6 +451,10 @@ void ScenarioManager::loadCurrentProject()
     Domain::Scenario* currentScenarioDraft =
             DataStorageLayer::StorageFacade::scenarioStorage()->current(IS_DRAFT);
     m_scenarioDraft->load(currentScenarioDraft);
+    //
+    // ... и применим изменения, которые не вошли в сохранённый текст
+    //
+    applyChangesSinceSnapshot();
 
     //
     // Установим данные для менеджеров
@@ -374,9 +466,8 @@ void ScenarioManager::loadCurrentProject()
     m_textEditManager->setScenarioDocument(m_scenarioDraft->document(), IS_DRAFT);
     m_textEditManager->setScenarioDocument(m_scenario->document());
     //
-    // ... содержимое карточек устанавливаем в последнюю очередь, чтобы корректно загрузить схему
+    // ... карточки загружаются отдельно, при первом обращении к ним
     //
-    m_cardsManager->load(m_scenario->model(), currentScenario->scheme());
 
     //
     // Обновим счётчики, когда данные полностью загрузятся
@@ -384,12 +475,43 @@ void ScenarioManager::loadCurrentProject()
     QTimer::singleShot(100, this, &ScenarioManager::aboutUpdateCounters);
 }
 
+void ScenarioManager::loadCards()
+{
+    //
+    // Сформируем изменения, чтобы учесть правки текста, сделанные до загрузки карточек
+    //
+    aboutSaveScenarioChanges();
+
+    //
+    // Если с момента сохранения схемы сценарий не менялся, то загружаем сохранённую схему
+    //
+    const QString scheme = m_scenario->scenario()->scheme();
+    const QString schemeRevision =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                CARDS_SCHEME_REVISION_KEY, DataStorageLayer::SettingsStorage::ScenarioSettings);
+    if (!scheme.isEmpty()
+        && !schemeRevision.isEmpty()
+        && schemeRevision == ::lastChangeUuid()) {
+        m_cardsManager->load(m_scenario->model(), scheme);
+        m_cardsSchemeRevision = schemeRevision;
+        m_isCardsLoaded = true;
+    }
+    //
+    // FIXME: В противном случае перестраиваем карточки, т.к. изменения текста,
+    //        в т.ч. пришедшие при синхронизации, не затрагивают схему
+    //
+    else {
+        rebuildCardsFromScript();
+    }
+}
+
 void ScenarioManager::rebuildCardsFromScript()
 {
     //
     // Передаём пустую строку вместо схемы, чтобы карточки построились из текста сценария
     //
     m_cardsManager->load(m_scenario->model(), QString());
+    m_isCardsLoaded = true;
 }
 
 void ScenarioManager::startChangesHandling()
@@ -426,22 +548,46 @@ void ScenarioManager::loadCurrentProjectSettings(const QString& _projectPath)
 void ScenarioManager::saveCurrentProject()
 {
     //
-    // Сохраняем сценарий
+    // Формируем изменения, чтобы они попали в журнал вместе с текущим сохранением
     //
-    m_scenario->scenario()->setText(m_scenario->save());
-    m_scenario->scenario()->setScheme(m_cardsManager->save());
-    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenario->scenario());
+    aboutSaveScenarioChanges();
 
     //
-    // Сохраняем черновик
+    // Если инкрементальное сохранение выключено, или пришло время, то сохраняем текст целиком
     //
-    m_scenarioDraft->scenario()->setText(m_scenarioDraft->save());
-    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenarioDraft->scenario());
+    if (!isIncrementalSaveEnabled()
+        || m_isSnapshotChangeMissing
+        || m_savesSinceSnapshot >= SAVES_BETWEEN_SNAPSHOTS) {
+        saveScriptSnapshot();
+    }
+    //
+    // В противном случае текст восстанавливается из журнала изменений, поэтому сохраняем
+    // только отметку о последнем снимке и схему карточек, если она изменилась
+    //
+    else {
+        if (!m_hasChangesSinceSnapshot) {
+            DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                        SNAPSHOT_LAST_CHANGE_KEY, m_snapshotLastChangeUuid,
+                        DataStorageLayer::SettingsStorage::ScenarioSettings);
+            m_hasChangesSinceSnapshot = true;
+        }
+
+        //
+        // NOTE: Текст сценария в объекте остаётся таким, каким он был при сохранении снимка,
+        //       так что снимок не нарушается
+        //
+        if (m_isCardsLoaded && m_isCardsChanged) {
+            updateCardsScheme();
+            DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenario->scenario());
+            m_isCardsChanged = false;
+        }
+
+        ++m_savesSinceSnapshot;
+    }
 
     //
     // Сохраняем изменения
     //
-    aboutSaveScenarioChanges();
     DataStorageLayer::StorageFacade::scenarioChangeStorage()->store();
 }
 
@@ -464,13 +610,31 @@ void ScenarioManager::saveCurrentProjectSettings(const QString& _projectPath)
                 DataStorageLayer::SettingsStorage::ApplicationSettings);
 }
 
-void ScenarioManager::closeCurrentProject()
+void ScenarioManager::closeCurrentProject(bool _isChangesDiscarded)
 {
     //
     // Остановим таймер сохранения изменений документа
     //
     m_saveChangesTimer.stop();
 
+    //
+    // Если в проекте остались изменения не вошедшие в снимок текста, сохраним полный снимок,
+    // чтобы файл можно было открыть без восстановления из журнала изменений. Если же пользователь
+    // отказался от несохранённых изменений, то файл не трогаем, он и так открывается корректно
+    //
+    if (m_hasChangesSinceSnapshot
+        && !_isChangesDiscarded) {
+        DatabaseLayer::Database::transaction();
+        compactSavedScript();
+        DatabaseLayer::Database::commit();
+    }
+    m_snapshotLastChangeUuid.clear();
+    m_isSnapshotChangeMissing = false;
+    m_savesSinceSnapshot = 0;
+    m_isCardsChanged = false;
+    m_isCardsLoaded = false;
+    m_cardsSchemeRevision.clear();
+
     //
     // Очистим от предыдущих данных
     //
@@ -1055,7 +1219,9 @@ void ScenarioManager::aboutSaveScenarioChanges()
     //
     // Сохраняем изменения в карточках
     //
-    m_cardsManager->saveChanges(change != nullptr);
+    if (m_isCardsLoaded) {
+        m_cardsManager->saveChanges(change != nullptr);
+    }
 
 #ifdef Q_OS_MAC
     //
@@ -1075,6 +1241,150 @@ void ScenarioManager::aboutSaveScenarioChanges()
     emit updateCursorsRequest(cursorPosition(), m_workModeIsDraft);
 }
 
+void ScenarioManager::saveScriptSnapshot()
+{
+    //
+    // Сохраняем сценарий
+    //
+    m_scenario->scenario()->setText(m_scenario->save());
+    if (m_isCardsLoaded) {
+        updateCardsScheme();
+    }
+    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenario->scenario());
+
+    //
+    // Сохраняем черновик
+    //
+    m_scenarioDraft->scenario()->setText(m_scenarioDraft->save());
+    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenarioDraft->scenario());
+
+    //
+    // Снимок содержит все изменения, поэтому сбрасываем отметку о последнем снимке. Если же
+    // изменение снимка не нашлось в журнале, то отметку оставляем, чтобы не потерять
+    // указание на несведённые изменения
+    //
+    if (m_hasChangesSinceSnapshot
+        && !m_isSnapshotChangeMissing) {
+        DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                    SNAPSHOT_LAST_CHANGE_KEY, QString(),
+                    DataStorageLayer::SettingsStorage::ScenarioSettings);
+        m_hasChangesSinceSnapshot = false;
+    }
+    m_snapshotLastChangeUuid = ::lastChangeUuid();
+    m_savesSinceSnapshot = 0;
+    m_isCardsChanged = false;
+}
+
+void ScenarioManager::compactSavedScript()
+{
+    //
+    // Собираем патчи только тех изменений, которые уже записаны в файл. Если неизвестно,
+    // к какому изменению относится снимок, то свести изменения нельзя, поэтому оставляем
+    // файл как есть вместе с отметкой о снимке и журналом
+    //
+    QList<QString> patches;
+    QList<QString> draftPatches;
+    if (m_isSnapshotChangeMissing
+        || !::collectPatchesSinceSnapshot(m_snapshotLastChangeUuid, true, patches, draftPatches)) {
+        qWarning() << "Script snapshot change" << m_snapshotLastChangeUuid
+                   << "is not found in the change log, compaction is skipped";
+        return;
+    }
+
+    //
+    // Текст в объектах сценария остаётся таким, каким он был записан в последнем снимке,
+    // поэтому применяем к нему сохранённые изменения во временном документе, не затрагивая
+    // редактируемый документ, в котором могут быть несохранённые правки
+    //
+    auto compact = [] (Domain::Scenario* _scenario, const QList<QString>& _patches) {
+        if (_patches.isEmpty()) {
+            return;
+        }
+
+        ScenarioDocument script(nullptr);
+        script.load(_scenario);
+        script.document()->applyPatches(_patches);
+        _scenario->setText(script.save());
+        DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(_scenario);
+    };
+    compact(m_scenario->scenario(), patches);
+    compact(m_scenarioDraft->scenario(), draftPatches);
+
+    //
+    // Теперь снимок содержит все сохранённые изменения
+    //
+    DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                SNAPSHOT_LAST_CHANGE_KEY, QString(),
+                DataStorageLayer::SettingsStorage::ScenarioSettings);
+    m_hasChangesSinceSnapshot = false;
+}
+
+void ScenarioManager::updateCardsScheme()
+{
+    m_cardsManager->applyCardOperations();
+    m_scenario->scenario()->setScheme(m_cardsManager->save());
+
+    //
+    // Схема соответствует последнему изменению, т.к. перед сохранением все правки текста
+    // уже сформированы в изменения
+    //
+    const QString revision = ::lastChangeUuid();
+    if (m_cardsSchemeRevision != revision) {
+        DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                    CARDS_SCHEME_REVISION_KEY, revision,
+                    DataStorageLayer::SettingsStorage::ScenarioSettings);
+        m_cardsSchemeRevision = revision;
+    }
+}
+
+void ScenarioManager::applyChangesSinceSnapshot()
+{
+    m_savesSinceSnapshot = 0;
+
+    const QString snapshotLastChangeUuid =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                SNAPSHOT_LAST_CHANGE_KEY, DataStorageLayer::SettingsStorage::ScenarioSettings);
+    m_hasChangesSinceSnapshot = !snapshotLastChangeUuid.isEmpty();
+    if (!m_hasChangesSinceSnapshot) {
+        m_snapshotLastChangeUuid = ::lastChangeUuid();
+        return;
+    }
+    m_snapshotLastChangeUuid = snapshotLastChangeUuid;
+
+    //
+    // Собираем патчи изменений, следующих за последним вошедшим в снимок
+    //
+    QList<QString> patches;
+    QList<QString> draftPatches;
+    m_isSnapshotChangeMissing =
+            !::collectPatchesSinceSnapshot(snapshotLastChangeUuid, false, patches, draftPatches);
+
+    //
+    // Если изменения, вошедшего в снимок, нет в журнале, то применять к снимку нечего,
+    // т.к. неизвестно, какие изменения в нём уже учтены. Предупреждаем пользователя, а снимок
+    // и журнал оставляем нетронутыми до полного сохранения текста
+    //
+    if (m_isSnapshotChangeMissing) {
+        qWarning() << "Script snapshot change" << snapshotLastChangeUuid
+                   << "is not found in the change log, changes since the snapshot are not applied";
+        QLightBoxMessage::warning(m_view, tr("Script may be outdated"),
+            tr("The project contains script changes that can't be applied to the saved text. "
+               "The script is opened as it was last saved in full, so the latest changes may be missing. "
+               "Please check the script before continuing."));
+        return;
+    }
+
+    //
+    // Применяем их к загруженным документам
+    //
+    if (!patches.isEmpty()) {
+        m_scenario->document()->applyPatches(patches);
+    }
+    if (!draftPatches.isEmpty()) {
+        m_scenarioDraft->document()->applyPatches(draftPatches);
+    }
+}
+
 void ScenarioManager::initData()
 {
     m_navigatorManager->setNavigationModel(m_scenario->model());
@@ -1233,6 +1543,7 @@ void ScenarioManager::initConnections()
             m_textEditManager->setFixed(m_fixedScenesDraft);
         }
     });
+    connect(m_cardsManager, &ScenarioCardsManager::cardsChanged, this, [this] { m_isCardsChanged = true; });
     connect(m_cardsManager, &ScenarioCardsManager::cardsChanged, this, &ScenarioManager::scenarioChanged);
     connect(m_sceneDescriptionManager, &ScenarioSceneDescriptionManager::titleChanged, this, &ScenarioManager::scenarioChanged);
     connect(m_sceneDescriptionManager, &ScenarioSceneDescriptionManager::descriptionChanged, this, &ScenarioManager::scenarioChanged);
@@ -70,6 +70,13 @@ namespace ManagementLayer
          */
         void loadCurrentProject();
 
+        /**
+         * @brief Загрузить карточки
+         * @note Если сохранённая схема соответствует текущей ревизии сценария, то загружается она,
+         *       в противном случае карточки формируются из сценария
+         */
+        void loadCards();
+
         /**
          * @brief Сформировать карточки из сценария
          */
@@ -87,6 +94,8 @@ namespace ManagementLayer
 
         /**
          * @brief Сохранить данные текущего проекта
+         * @note В режиме инкрементального сохранения полный текст сценария сохраняется лишь
+         *       периодически, а между этим сохраняются только патчи изменений
          */
         void saveCurrentProject();
 
@@ -97,8 +106,9 @@ namespace ManagementLayer
 
         /**
          * @brief Закрыть текущий проект
+         * @param _isChangesDiscarded - пользователь отказался от сохранения изменений
          */
-        void closeCurrentProject();
+        void closeCurrentProject(bool _isChangesDiscarded = false);
 
         /**
          * @brief Установить режим работы со сценарием
@@ -407,6 +417,27 @@ namespace ManagementLayer
          */
         void changeSceneNumbersLocking();
 
+        /**
+         * @brief Сохранить полный снимок текста сценария и черновика
+         */
+        void saveScriptSnapshot();
+
+        /**
+         * @brief Сохранить полный снимок текста, собранный из последнего снимка и записанных
+         *        в файл изменений
+         */
+        void compactSavedScript();
+
+        /**
+         * @brief Применить изменения, сохранённые после последнего снимка текста
+         */
+        void applyChangesSinceSnapshot();
+
+        /**
+         * @brief Обновить схему карточек в сценарии и ревизию сценария, которой она соответствует
+         */
+        void updateCardsScheme();
+
     private:
         /**
          * @brief Представление сценария
@@ -506,6 +537,44 @@ namespace ManagementLayer
          * @brief Таймер для сохранения изменений сценария
          */
         QTimer m_saveChangesTimer;
+
+        /**
+         * @brief Идентификатор последнего изменения, вошедшего в сохранённый снимок текста
+         */
+        QString m_snapshotLastChangeUuid;
+
+        /**
+         * @brief Есть ли сохранённые изменения, не вошедшие в снимок текста
+         */
+        bool m_hasChangesSinceSnapshot = false;
+
+        /**
+         * @brief Не найдено ли в журнале изменение, которым заканчивается снимок текста
+         * @note В этом случае изменения не сводятся в снимок, а текст сохраняется целиком
+         */
+        bool m_isSnapshotChangeMissing = false;
+
+        /**
+         * @brief Количество инкрементальных сохранений с момента последнего снимка
+         */
+        int m_savesSinceSnapshot = 0;
+
+        /**
+         * @brief Изменились ли карточки с момента последнего сохранения
+         */
+        bool m_isCardsChanged = false;
+
+        /**
+         * @brief Загружены ли карточки
+         * @note Карточки загружаются при первом показе, поэтому до этого момента схему
+         *       нельзя сохранять, чтобы не затереть её пустой
+         */
+        bool m_isCardsLoaded = false;
+
+        /**
+         * @brief Ревизия сценария, которой соответствует сохранённая схема карточек
+         */
+        QString m_cardsSchemeRevision;
     };
 }
 
@@ -0,0 +1,419 @@
+#include "DictionaryDownloader.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+using ManagementLayer::DictionaryDownloader;
+
+namespace {
+    /**
+     * @brief Имя файла манифеста с контрольными суммами словарей
+     * @note Формат совпадает с выводом sha256sum: "<хэш> <имя файла>" в каждой строке
+     */
+    const QString kManifestFileName = "SHA256SUMS";
+
+    /**
+     * @brief Расширение временных файлов загрузки
+     */
+    const QString kPartFileExtension = ".part";
+
+    /**
+     * @brief Расширение файла с валидатором (ETag или Last-Modified) версии, к которой
+     *        относятся данные временного файла загрузки
+     */
+    const QString kValidatorFileExtension = ".validator";
+
+    /**
+     * @brief Расширение резервной копии заменяемого файла
+     */
+    const QString kBackupFileExtension = ".old";
+
+    /**
+     * @brief Максимальное количество перенаправлений при загрузке файла
+     */
+    const int kMaxRedirects = 5;
+
+    /**
+     * @brief Коды ответов сервера
+     */
+    /** @{ */
+    const int kHttpOk = 200;
+    const int kHttpPartialContent = 206;
+    const int kHttpRangeNotSatisfiable = 416;
+    /** @} */
+
+    /**
+     * @brief Получить из ответа валидатор версии файла для заголовка If-Range
+     * @note If-Range допускает только сильный ETag, поэтому слабый заменяется датой изменения
+     */
+    static QByteArray responseValidator(QNetworkReply* _reply) {
+        const QByteArray etag = _reply->rawHeader("ETag");
+        if (!etag.isEmpty()
+            && !etag.startsWith("W/")) {
+            return etag;
+        }
+        return _reply->rawHeader("Last-Modified");
+    }
+
+    /**
+     * @brief Прочитать сохранённый валидатор
+     */
+    static QByteArray readValidator(const QString& _filePath) {
+        QFile file(_filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+        return file.readAll().trimmed();
+    }
+
+    /**
+     * @brief Сохранить валидатор, пустой валидатор удаляет файл
+     */
+    static void writeValidator(const QString& _filePath, const QByteArray& _validator) {
+        if (_validator.isEmpty()) {
+            QFile::remove(_filePath);
+            return;
+        }
+        QFile file(_filePath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(_validator);
+        }
+    }
+}
+
+
+DictionaryDownloader::DictionaryDownloader(const QUrl& _baseUrl, const QString& _targetFolderPath, QObject* _parent) :
+    QObject(_parent),
+    m_networkManager(new QNetworkAccessManager(this)),
+    m_baseUrl(_baseUrl),
+    m_targetFolderPath(_targetFolderPath)
+{
+}
+
+void DictionaryDownloader::download(const QStringList& _fileNames)
+{
+    m_files.clear();
+    m_replies.clear();
+    m_checksums.clear();
+    m_lastError.clear();
+    m_lastProgress = -1;
+
+    QDir::root().mkpath(m_targetFolderPath);
+
+    //
+    // Сначала формируем список файлов целиком, чтобы индексы в обработчиках оставались валидными
+    //
+    for (const QString& fileName : _fileNames) {
+        FileDownload fileDownload;
+        fileDownload.fileName = fileName;
+        m_files.append(fileDownload);
+    }
+
+    //
+    // Файлы загружаем после манифеста, т.к. продолжить прерванную загрузку можно только тогда,
+    // когда результат удастся сверить с контрольной суммой
+    //
+    QNetworkReply* manifestReply = m_networkManager->get(makeRequest(kManifestFileName));
+    m_replies.append(manifestReply);
+    connect(manifestReply, &QNetworkReply::finished, this, [this, manifestReply] {
+        const bool isCanceled = manifestReply->error() == QNetworkReply::OperationCanceledError;
+        if (manifestReply->error() == QNetworkReply::NoError) {
+            parseManifest(manifestReply->readAll());
+        } else if (isCanceled) {
+            m_lastError = manifestReply->errorString();
+        }
+        m_replies.removeOne(manifestReply);
+        manifestReply->deleteLater();
+
+        if (!isCanceled) {
+            for (int index = 0; index < m_files.size(); ++index) {
+                startFile(index);
+            }
+        }
+        replyFinished();
+    });
+}
+
+void DictionaryDownloader::stop()
+{
+    const QVector<QNetworkReply*> replies = m_replies;
+    for (QNetworkReply* reply : replies) {
+        reply->abort();
+    }
+}
+
+QString DictionaryDownloader::lastError() const
+{
+    return m_lastError;
+}
+
+QNetworkRequest DictionaryDownloader::makeRequest(const QString& _fileName) const
+{
+    QNetworkRequest request(m_baseUrl.resolved(QUrl(_fileName)));
+#if QT_VERSION >= 0x050800
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+#if QT_VERSION >= 0x050600
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    request.setMaximumRedirectsAllowed(kMaxRedirects);
+#endif
+    return request;
+}
+
+void DictionaryDownloader::startFile(int _index)
+{
+    FileDownload& fileDownload = m_files[_index];
+    fileDownload.received = 0;
+    fileDownload.total = 0;
+    fileDownload.httpStatus = 0;
+    fileDownload.isResumed = false;
+
+    //
+    // Продолжаем запись во временный файл, если он остался от прерванной загрузки
+    //
+    delete fileDownload.file;
+    fileDownload.file = new QFile(partFilePath(fileDownload.fileName), this);
+    if (!fileDownload.file->open(QIODevice::ReadWrite)) {
+        m_lastError = fileDownload.file->errorString();
+        return;
+    }
+    //
+    // ... но только если известно, к какой версии файла относятся загруженные данные,
+    //     и собранный из частей файл можно будет сверить с манифестом
+    //
+    const QByteArray validator = readValidator(validatorFilePath(fileDownload.fileName));
+    if (validator.isEmpty()
+        || !m_checksums.contains(fileDownload.fileName)) {
+        fileDownload.file->resize(0);
+    }
+    fileDownload.offset = fileDownload.file->size();
+    fileDownload.file->seek(fileDownload.offset);
+
+    //
+    // Если файл на сервере изменился, то If-Range заставит сервер прислать его целиком
+    //
+    QNetworkRequest request = makeRequest(fileDownload.fileName);
+    if (fileDownload.offset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(fileDownload.offset) + "-");
+        request.setRawHeader("If-Range", validator);
+    }
+
+    QNetworkReply* reply = m_networkManager->get(request);
+    m_replies.append(reply);
+
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, _index, reply] {
+        FileDownload& fileDownload = m_files[_index];
+        fileDownload.httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        //
+        // Если сервер не поддерживает докачку, или файл изменился, то он пришлёт файл целиком,
+        // запоминаем версию, чтобы при обрыве продолжить загрузку именно её
+        //
+        if (fileDownload.httpStatus == kHttpOk) {
+            if (fileDownload.offset > 0) {
+                fileDownload.file->resize(0);
+                fileDownload.file->seek(0);
+                fileDownload.offset = 0;
+            }
+            writeValidator(validatorFilePath(fileDownload.fileName), ::responseValidator(reply));
+        } else if (fileDownload.httpStatus == kHttpPartialContent) {
+            fileDownload.isResumed = true;
+        }
+        const qint64 contentLength = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (contentLength > 0) {
+            fileDownload.total = fileDownload.offset + contentLength;
+        }
+    });
+    connect(reply, &QNetworkReply::readyRead, this, [this, _index, reply] {
+        FileDownload& fileDownload = m_files[_index];
+        if (fileDownload.httpStatus != kHttpOk
+            && fileDownload.httpStatus != kHttpPartialContent) {
+            return;
+        }
+
+        const QByteArray data = reply->readAll();
+        if (fileDownload.file->write(data) != data.size()) {
+            m_lastError = fileDownload.file->errorString();
+            reply->abort();
+            return;
+        }
+        fileDownload.received += data.size();
+        updateProgress();
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, _index, reply] {
+        FileDownload& fileDownload = m_files[_index];
+        fileDownload.file->close();
+        //
+        // Сервер отвечает 416, если запрошенный диапазон начинается за концом файла. Временный
+        // файл считается загруженным целиком, только если его размер совпадает с размером файла
+        // на сервере из заголовка "Content-Range: bytes */<размер>", а его корректность затем
+        // определит проверка контрольной суммы. Иначе загружаем файл заново
+        //
+        bool needRestart = false;
+        if (fileDownload.httpStatus == kHttpRangeNotSatisfiable) {
+            const QByteArray contentRange = reply->rawHeader("Content-Range");
+            const int sizeIndex = contentRange.lastIndexOf('/');
+            const qint64 remoteSize = sizeIndex != -1 ? contentRange.mid(sizeIndex + 1).toLongLong() : -1;
+            if (remoteSize == fileDownload.offset) {
+                fileDownload.total = fileDownload.offset;
+                fileDownload.isResumed = true;
+            } else {
+                QFile::remove(validatorFilePath(fileDownload.fileName));
+                needRestart = true;
+            }
+        } else if (reply->error() != QNetworkReply::NoError
+                   && m_lastError.isEmpty()) {
+            m_lastError = reply->errorString();
+        }
+        m_replies.removeOne(reply);
+        reply->deleteLater();
+
+        if (needRestart) {
+            startFile(_index);
+        }
+        replyFinished();
+    });
+}
+
+void DictionaryDownloader::parseManifest(const QByteArray& _manifest)
+{
+    for (const QByteArray& line : _manifest.split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() != 2) {
+            continue;
+        }
+
+        QString fileName = QString::fromUtf8(fields.last());
+        if (fileName.startsWith('*')) {
+            fileName.remove(0, 1);
+        }
+        m_checksums.insert(fileName, fields.first().toLower());
+    }
+}
+
+void DictionaryDownloader::replyFinished()
+{
+    if (!m_replies.isEmpty()) {
+        return;
+    }
+
+    //
+    // Все запросы завершены, проверяем загруженные файлы
+    //
+    bool success = m_lastError.isEmpty();
+    for (const FileDownload& fileDownload : m_files) {
+        if (success
+            && !verify(fileDownload)) {
+            //
+            // Повреждённый файл докачивать бессмысленно, поэтому удаляем его
+            //
+            QFile::remove(partFilePath(fileDownload.fileName));
+            QFile::remove(validatorFilePath(fileDownload.fileName));
+            m_lastError = tr("Downloaded file %1 is corrupted").arg(fileDownload.fileName);
+            success = false;
+        }
+    }
+
+    //
+    // Устанавливаем файлы только когда все они успешно загружены
+    //
+    if (success) {
+        for (const FileDownload& fileDownload : m_files) {
+            if (!install(fileDownload.fileName)) {
+                m_lastError = tr("Can't install file %1").arg(fileDownload.fileName);
+                success = false;
+                break;
+            }
+        }
+    }
+
+    for (FileDownload& fileDownload : m_files) {
+        delete fileDownload.file;
+        fileDownload.file = nullptr;
+    }
+
+    emit finished(success);
+}
+
+bool DictionaryDownloader::verify(const FileDownload& _fileDownload) const
+{
+    const QString filePath = partFilePath(_fileDownload.fileName);
+    const QByteArray expectedChecksum = m_checksums.value(_fileDownload.fileName);
+    if (expectedChecksum.isEmpty()) {
+        //
+        // Без контрольной суммы принимаем только файл, загруженный за один раз,
+        // размер которого совпал с заявленным сервером
+        //
+        return !_fileDownload.isResumed
+                && _fileDownload.total > 0
+                && QFileInfo(filePath).size() == _fileDownload.total;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&file);
+    return hash.result().toHex() == expectedChecksum;
+}
+
+bool DictionaryDownloader::install(const QString& _fileName)
+{
+    const QString targetFilePath = m_targetFolderPath + _fileName;
+    const QString backupFilePath = targetFilePath + kBackupFileExtension;
+
+    //
+    // Прежний файл убираем в резерв, чтобы вернуть его, если замена не удастся
+    //
+    QFile::remove(backupFilePath);
+    const bool hasPreviousFile = QFile::exists(targetFilePath);
+    if (hasPreviousFile
+        && !QFile::rename(targetFilePath, backupFilePath)) {
+        return false;
+    }
+
+    if (!QFile::rename(partFilePath(_fileName), targetFilePath)) {
+        if (hasPreviousFile) {
+            QFile::rename(backupFilePath, targetFilePath);
+        }
+        return false;
+    }
+
+    QFile::remove(backupFilePath);
+    QFile::remove(validatorFilePath(_fileName));
+    return true;
+}
+
+QString DictionaryDownloader::partFilePath(const QString& _fileName) const
+{
+    return m_targetFolderPath + _fileName + kPartFileExtension;
+}
+
+QString DictionaryDownloader::validatorFilePath(const QString& _fileName) const
+{
+    return partFilePath(_fileName) + kValidatorFileExtension;
+}
+
+void DictionaryDownloader::updateProgress()
+{
+    qint64 loaded = 0;
+    qint64 total = 0;
+    for (const FileDownload& fileDownload : m_files) {
+        loaded += fileDownload.offset + fileDownload.received;
+        total += fileDownload.total;
+    }
+    if (total <= 0) {
+        return;
+    }
+
+    const int progress = static_cast<int>(qMin<qint64>(100, loaded * 100 / total));
+    if (m_lastProgress != progress) {
+        m_lastProgress = progress;
+        emit progressChanged(progress);
+    }
+}
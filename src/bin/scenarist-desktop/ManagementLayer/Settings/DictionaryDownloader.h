@@ -0,0 +1,194 @@
+#ifndef DICTIONARYDOWNLOADER_H
+#define DICTIONARYDOWNLOADER_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QUrl>
+#include <QVector>
+
+class QFile;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QNetworkRequest;
+
+
+namespace ManagementLayer
+{
+    /**
+     * @brief Загрузчик файлов словарей проверки орфографии
+     *
+     * Файлы загружаются параллельно и пишутся на диск по мере получения во временные файлы,
+     * прерванная загрузка продолжается с места остановки (HTTP Range и If-Range), если файл
+     * есть в манифесте контрольных сумм. После загрузки файлы сверяются с манифестом
+     * и только затем заменяют собой установленные
+     */
+    class DictionaryDownloader : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * @param _baseUrl - ссылка на папку со словарями на сервере
+         * @param _targetFolderPath - папка, в которую устанавливаются словари
+         */
+        DictionaryDownloader(const QUrl& _baseUrl, const QString& _targetFolderPath, QObject* _parent = nullptr);
+
+        /**
+         * @brief Загрузить и установить заданные файлы
+         */
+        void download(const QStringList& _fileNames);
+
+        /**
+         * @brief Прервать загрузку, уже загруженные данные сохранятся для докачки
+         */
+        void stop();
+
+        /**
+         * @brief Описание последней ошибки
+         */
+        QString lastError() const;
+
+    signals:
+        /**
+         * @brief Изменился прогресс загрузки, в процентах
+         */
+        void progressChanged(int _progress);
+
+        /**
+         * @brief Загрузка завершена
+         */
+        void finished(bool _success);
+
+    private:
+        struct FileDownload;
+
+        /**
+         * @brief Сформировать запрос на загрузку файла
+         */
+        QNetworkRequest makeRequest(const QString& _fileName) const;
+
+        /**
+         * @brief Начать загрузку файла с заданным индексом
+         */
+        void startFile(int _index);
+
+        /**
+         * @brief Разобрать манифест контрольных сумм
+         */
+        void parseManifest(const QByteArray& _manifest);
+
+        /**
+         * @brief Обработать завершение очередного ответа
+         */
+        void replyFinished();
+
+        /**
+         * @brief Проверить целостность загруженного файла
+         */
+        bool verify(const FileDownload& _fileDownload) const;
+
+        /**
+         * @brief Заменить установленный файл загруженным
+         */
+        bool install(const QString& _fileName);
+
+        /**
+         * @brief Путь к временному файлу загрузки
+         */
+        QString partFilePath(const QString& _fileName) const;
+
+        /**
+         * @brief Путь к файлу с валидатором версии, к которой относится временный файл
+         */
+        QString validatorFilePath(const QString& _fileName) const;
+
+        /**
+         * @brief Пересчитать прогресс загрузки
+         */
+        void updateProgress();
+
+    private:
+        /**
+         * @brief Состояние загрузки одного файла
+         */
+        struct FileDownload {
+            /**
+             * @brief Имя файла
+             */
+            QString fileName;
+
+            /**
+             * @brief Временный файл, в который пишутся данные
+             */
+            QFile* file = nullptr;
+
+            /**
+             * @brief Сколько байт было загружено ранее
+             */
+            qint64 offset = 0;
+
+            /**
+             * @brief Сколько байт загружено в текущей сессии
+             */
+            qint64 received = 0;
+
+            /**
+             * @brief Полный размер файла, если известен
+             */
+            qint64 total = 0;
+
+            /**
+             * @brief Код ответа сервера
+             */
+            int httpStatus = 0;
+
+            /**
+             * @brief Собран ли файл из данных нескольких загрузок
+             */
+            bool isResumed = false;
+        };
+
+        /**
+         * @brief Менеджер сети, общий для всех загрузок словарей
+         */
+        QNetworkAccessManager* m_networkManager = nullptr;
+
+        /**
+         * @brief Ссылка на папку со словарями на сервере
+         */
+        QUrl m_baseUrl;
+
+        /**
+         * @brief Папка установки словарей
+         */
+        QString m_targetFolderPath;
+
+        /**
+         * @brief Загружаемые файлы
+         */
+        QVector<FileDownload> m_files;
+
+        /**
+         * @brief Выполняющиеся запросы
+         */
+        QVector<QNetworkReply*> m_replies;
+
+        /**
+         * @brief Контрольные суммы SHA-256 из манифеста по именам файлов
+         */
+        QHash<QString, QByteArray> m_checksums;
+
+        /**
+         * @brief Описание последней ошибки
+         */
+        QString m_lastError;
+
+        /**
+         * @brief Последнее отправленное значение прогресса
+         */
+        int m_lastProgress = -1;
+    };
+}
+
+#endif // DICTIONARYDOWNLOADER_H
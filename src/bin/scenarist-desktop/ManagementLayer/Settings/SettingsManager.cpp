@@ -1,4 +1,5 @@
 #include "SettingsManager.h"
+#include "DictionaryDownloader.h"
 #include "SettingsTemplatesManager.h"
 
 #include <DataLayer/DataStorageLayer/StorageFacade.h>
@@ -16,15 +17,15 @@
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxprogress.h>
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxmessage.h>
 
-#include <NetworkRequestLoader.h>
-
 #include <QApplication>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QSplitter>
 #include <QStandardItemModel>
 #include <QStandardPaths>
 #include <QStringListModel>
 
+using ManagementLayer::DictionaryDownloader;
 using ManagementLayer::SettingsManager;
 using ManagementLayer::SettingsTemplatesManager;
 using BusinessLogic::ScenarioTemplate;
@@ -362,32 +363,22 @@ void SettingsManager::scenarioEditSpellCheckLanguageChanged(int _value)
         rootFolder.mkpath(hunspellDictionariesFolderPath);
 
         //
-        // ... скачаем словарь
-        //
-        const QString hunspellDictionariesFolderUrl = "https://kitscenarist.ru/downloads/hunspell/";
+        // ... скачаем оба файла словаря параллельно, дождавшись завершения загрузки
         //
-        NetworkRequest dictionaryLoader;
-        connect(&dictionaryLoader, &NetworkRequest::downloadProgress, this, [] (int _value) {
+        const QUrl hunspellDictionariesFolderUrl("https://kitscenarist.ru/downloads/hunspell/");
+        DictionaryDownloader dictionaryDownloader(hunspellDictionariesFolderUrl, hunspellDictionariesFolderPath);
+        connect(&dictionaryDownloader, &DictionaryDownloader::progressChanged, this, [] (int _value) {
             QLightBoxProgress::setProgressValue(_value);
         });
-        const QByteArray affFileData = dictionaryLoader.loadSync(hunspellDictionariesFolderUrl + affFileName);
-        bool downloadingAffFileSuccess = affFileData.size() > 0;
-        if (downloadingAffFileSuccess) {
-            QFile affFile(hunspellDictionariesFolderPath + affFileName);
-            affFile.open(QIODevice::WriteOnly);
-            affFile.write(affFileData);
-            affFile.close();
-        }
-        //
-        progress.setProgressValue(0);
-        const QByteArray dicFileData = dictionaryLoader.loadSync(hunspellDictionariesFolderUrl + dicFileName);
-        bool downloadingDicFileSuccess = dicFileData.size() > 100;
-        if (downloadingDicFileSuccess) {
-            QFile dicFile(hunspellDictionariesFolderPath + dicFileName);
-            dicFile.open(QIODevice::WriteOnly);
-            dicFile.write(dicFileData);
-            dicFile.close();
-        }
+        bool downloadingSuccess = false;
+        QEventLoop downloadingLoop;
+        connect(&dictionaryDownloader, &DictionaryDownloader::finished, &downloadingLoop,
+                [&downloadingSuccess, &downloadingLoop] (bool _success) {
+            downloadingSuccess = _success;
+            downloadingLoop.quit();
+        });
+        dictionaryDownloader.download({ affFileName, dicFileName });
+        downloadingLoop.exec();
 
         //
         // ... скрываем прогресс
@@ -397,7 +388,7 @@ void SettingsManager::scenarioEditSpellCheckLanguageChanged(int _value)
         //
         // Если словари не удалось скачать, предупредим об этом пользователя
         //
-        if (!downloadingAffFileSuccess || !downloadingDicFileSuccess) {
+        if (!downloadingSuccess) {
             QLightBoxMessage::critical(m_view, tr("Can't enable spell checking"),
                 tr("Can't download spelling dictionary. "
                    "Please check internet connection and retry to activate spell checking"));
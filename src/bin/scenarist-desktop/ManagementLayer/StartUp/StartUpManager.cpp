@@ -153,6 +153,7 @@ void StartUpManager::checkNewVersion()
 {
     NetworkRequest loader;
     loader.setRequestMethod(NetworkRequestMethod::Post);
+    loader.setPriority(NetworkRequestPriority::Low);
 
     //
     // Сформируем uuid для приложения, по которому будем идентифицировать данного пользователя
@@ -23,8 +23,19 @@
 
 #include "qtzip/QtZipReader"
 
+#include <QBuffer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QScopedPointer>
 #include <QTextDocument>
 #include <QXmlStreamAttributes>
+#include <QtConcurrent>
+
+#if 0
+#define DOCXDEBUG qDebug
+#else
+#define DOCXDEBUG if (0) qDebug
+#endif
 
 namespace {
     qreal pixelsFromTwips(qint32 _twips)
@@ -99,7 +110,8 @@ void DocxReader::Comment::insertIfReady(const QTextCursor& _cursor) const
 //-----------------------------------------------------------------------------
 
 DocxReader::DocxReader() :
-    m_in_block(false)
+    m_in_block(false),
+    m_progress_total(0)
 {
     m_xml.setNamespaceProcessing(false);
 }
@@ -117,27 +129,65 @@ void DocxReader::readData(QIODevice* device)
 {
     m_in_block = m_cursor.document()->blockCount();
     m_current_style.block_format = m_cursor.blockFormat();
+    m_runs.clear();
 
     // Open archive
     QtZipReader zip(device);
 
     // Read archive
     if (zip.isReadable()) {
-        const QString files[] = {
-            QString::fromLatin1("word/styles.xml"),
-            QString::fromLatin1("word/comments.xml"),
-            QString::fromLatin1("word/document.xml")
-        };
-        for (int i = 0; i < 3; ++i) {
-            QByteArray data = zip.fileData(files[i]);
-            if (data.isEmpty()) {
-                continue;
+        //
+        // Стили и комментарии не зависят друг от друга, поэтому разбираем их в отдельных
+        // потоках, а в текущем тем временем распаковываем документ. К результатам
+        // присоединяемся перед разбором документа, которому они нужны
+        //
+        const QByteArray styles_data = zip.fileData(QString::fromLatin1("word/styles.xml"));
+        const bool has_styles = !styles_data.isEmpty();
+        QFuture<StylesParseResult> styles_future;
+        if (has_styles) {
+            styles_future = QtConcurrent::run(&DocxReader::readStylesData, styles_data, m_current_style);
+        }
+
+        const QByteArray comments_data = zip.fileData(QString::fromLatin1("word/comments.xml"));
+        const bool has_comments = !comments_data.isEmpty();
+        QFuture<CommentsParseResult> comments_future;
+        if (has_comments) {
+            comments_future = QtConcurrent::run(&DocxReader::readComments, comments_data);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray document_data = zip.fileData(QString::fromLatin1("word/document.xml"));
+        DOCXDEBUG() << "DOCX import: word/document.xml inflated in" << timer.elapsed() << "ms";
+
+        if (has_styles) {
+            const StylesParseResult styles = styles_future.result();
+            DOCXDEBUG() << "DOCX import: word/styles.xml parsed in" << styles.elapsed << "ms";
+            m_styles = styles.styles;
+            m_current_style = styles.default_style;
+            if (!styles.error.isEmpty()) {
+                m_error = styles.error;
             }
-            m_xml.addData(data);
+        }
+        if (has_comments) {
+            const CommentsParseResult comments = comments_future.result();
+            DOCXDEBUG() << "DOCX import: word/comments.xml parsed in" << comments.elapsed << "ms";
+            m_comments = comments.comments;
+            if (!comments.error.isEmpty() && m_error.isEmpty()) {
+                m_error = comments.error;
+            }
+        }
+
+        if (m_error.isEmpty() && !document_data.isEmpty()) {
+            timer.restart();
+            QBuffer document(&document_data);
+            document.open(QIODevice::ReadOnly);
+            m_progress_total = document.size();
+            m_xml.setDevice(&document);
             readContent();
+            DOCXDEBUG() << "DOCX import: word/document.xml parsed in" << timer.elapsed() << "ms";
             if (m_xml.hasError()) {
                 m_error = m_xml.errorString();
-                break;
             }
             m_xml.clear();
         }
@@ -147,8 +197,6 @@ void DocxReader::readData(QIODevice* device)
 
     // Close archive
     zip.close();
-
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
 //-----------------------------------------------------------------------------
@@ -158,8 +206,6 @@ void DocxReader::readContent()
     m_xml.readNextStartElement();
     if (m_xml.qualifiedName() == "w:styles") {
         readStyles();
-    } else if (m_xml.qualifiedName() == "w:comments") {
-        readComments();
     } else if (m_xml.qualifiedName() == "w:document") {
         readDocument();
     }
@@ -290,56 +336,98 @@ void DocxReader::readStyles()
 
 //-----------------------------------------------------------------------------
 
-void DocxReader::readComments()
+DocxReader::StylesParseResult DocxReader::readStylesData(const QByteArray& data, const Style& default_style)
 {
-    if (!m_xml.readNextStartElement()) {
-        return;
+    QElapsedTimer timer;
+    timer.start();
+
+    //
+    // Разбираем отдельным ридером, чтобы не трогать состояние основного из другого потока
+    //
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    DocxReader reader;
+    reader.m_current_style = default_style;
+    reader.m_xml.setDevice(&buffer);
+    reader.readContent();
+
+    StylesParseResult result;
+    result.styles = reader.m_styles;
+    result.default_style = reader.m_current_style;
+    if (reader.m_xml.hasError()) {
+        result.error = reader.m_xml.errorString();
+    }
+    result.elapsed = timer.elapsed();
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+
+DocxReader::CommentsParseResult DocxReader::readComments(const QByteArray& data)
+{
+    CommentsParseResult result;
+    QElapsedTimer timer;
+    timer.start();
+
+    QXmlStreamReader xml(data);
+    xml.setNamespaceProcessing(false);
+    xml.readNextStartElement();
+    if (xml.qualifiedName() != "w:comments" || !xml.readNextStartElement()) {
+        result.elapsed = timer.elapsed();
+        return result;
     }
 
     // Read comments
     do {
-        if (m_xml.qualifiedName() == "w:comment") {
+        if (xml.qualifiedName() == "w:comment") {
             Comment comment;
 
             // Find comment ID
-            const QString comment_id = m_xml.attributes().value(QLatin1String("w:id")).toString();
-            if (m_comments.contains(comment_id)) {
-                m_xml.skipCurrentElement();
+            const QString comment_id = xml.attributes().value(QLatin1String("w:id")).toString();
+            if (result.comments.contains(comment_id)) {
+                xml.skipCurrentElement();
                 continue;
             }
 
             // Read comment contents
-            comment.author = m_xml.attributes().value(QLatin1String("w:author")).toString();
-            comment.date = m_xml.attributes().value(QLatin1String("w:date")).toString();
-            while (m_xml.readNextStartElement()) {
-                if (m_xml.qualifiedName() == "w:p") {
+            comment.author = xml.attributes().value(QLatin1String("w:author")).toString();
+            comment.date = xml.attributes().value(QLatin1String("w:date")).toString();
+            while (xml.readNextStartElement()) {
+                if (xml.qualifiedName() == "w:p") {
                     if (!comment.text.isEmpty()) {
                         comment.text.append("\n");
                     }
-                    while (m_xml.readNextStartElement()) {
-                        if (m_xml.qualifiedName() == "w:r") {
-                            while (m_xml.readNextStartElement()) {
-                                if (m_xml.qualifiedName() == "w:t") {
-                                    comment.text.append(m_xml.readElementText());
+                    while (xml.readNextStartElement()) {
+                        if (xml.qualifiedName() == "w:r") {
+                            while (xml.readNextStartElement()) {
+                                if (xml.qualifiedName() == "w:t") {
+                                    comment.text.append(xml.readElementText());
                                 } else {
-                                    m_xml.skipCurrentElement();
+                                    xml.skipCurrentElement();
                                 }
                             }
                         } else {
-                            m_xml.skipCurrentElement();
+                            xml.skipCurrentElement();
                         }
                     }
                 } else {
-                    m_xml.skipCurrentElement();
+                    xml.skipCurrentElement();
                 }
             }
 
             // Add to comments list
-            m_comments.insert(comment_id, comment);
-        } else if (m_xml.tokenType() != QXmlStreamReader::EndElement) {
-            m_xml.skipCurrentElement();
+            result.comments.insert(comment_id, comment);
+        } else if (xml.tokenType() != QXmlStreamReader::EndElement) {
+            xml.skipCurrentElement();
         }
-    } while (m_xml.readNextStartElement());
+    } while (xml.readNextStartElement());
+
+    if (xml.hasError()) {
+        result.error = xml.errorString();
+    }
+    result.elapsed = timer.elapsed();
+    return result;
 }
 
 //-----------------------------------------------------------------------------
@@ -354,6 +442,7 @@ void DocxReader::readDocument()
             m_xml.skipCurrentElement();
         }
     }
+    m_runs.flush(m_cursor);
     m_cursor.endEditBlock();
 }
 
@@ -367,11 +456,12 @@ void DocxReader::readBody()
         } else if ((m_xml.qualifiedName() == "w:commentRangeStart")
                    || (m_xml.qualifiedName() == "w:bookmarkStart")) {
             m_current_comment.clear();
-            m_current_comment.start_position = m_cursor.position();
+            m_current_comment.start_position = m_runs.position(m_cursor);
             m_xml.skipCurrentElement();
         } else if ((m_xml.qualifiedName() == "w:commentRangeEnd")
                    || (m_xml.qualifiedName() == "w:bookmarkEnd")) {
-            m_current_comment.end_position = m_cursor.position();
+            m_current_comment.end_position = m_runs.position(m_cursor);
+            m_runs.flush(m_cursor);
             m_current_comment.insertIfReady(m_cursor);
 
             m_xml.skipCurrentElement();
@@ -412,11 +502,12 @@ void DocxReader::readParagraph()
             } else if ((m_xml.qualifiedName() == "w:commentRangeStart")
                        || (m_xml.qualifiedName() == "w:bookmarkStart")) {
                 m_current_comment.clear();
-                m_current_comment.start_position = m_cursor.position();
+                m_current_comment.start_position = m_runs.position(m_cursor);
                 m_xml.skipCurrentElement();
             } else if ((m_xml.qualifiedName() == "w:commentRangeEnd")
                        || (m_xml.qualifiedName() == "w:bookmarkEnd")) {
-                m_current_comment.end_position = m_cursor.position();
+                m_current_comment.end_position = m_runs.position(m_cursor);
+                m_runs.flush(m_cursor);
                 m_current_comment.insertIfReady(m_cursor);
 
                 m_xml.skipCurrentElement();
@@ -425,6 +516,7 @@ void DocxReader::readParagraph()
             }
         } while (m_xml.readNextStartElement());
     }
+    m_runs.flush(m_cursor);
     m_in_block = false;
 
     // Reset paragraph styling
@@ -432,7 +524,10 @@ void DocxReader::readParagraph()
         m_current_style = m_previous_styles.pop();
     }
 
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    // Count the unread bytes of the inflated document
+    if (!reportProgress(m_progress_total - m_xml.device()->bytesAvailable(), m_progress_total)) {
+        m_xml.raiseError(canceledError());
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -533,22 +628,23 @@ void DocxReader::readRun()
             if (m_xml.qualifiedName() == "w:t") {
                 readText();
             } else if (m_xml.qualifiedName() == "w:tab") {
-                m_cursor.insertText(QChar(0x0009), m_current_style.char_format);
+                m_runs.append(QString(QChar(0x0009)), m_current_style.char_format);
                 m_xml.skipCurrentElement();
             } else if (m_xml.qualifiedName() == "w:br") {
-                m_cursor.insertText(QChar(0x2028), m_current_style.char_format);
+                m_runs.append(QString(QChar(0x2028)), m_current_style.char_format);
                 m_xml.skipCurrentElement();
             } else if (m_xml.qualifiedName() == "w:cr") {
-                m_cursor.insertText(QChar(0x2028), m_current_style.char_format);
+                m_runs.append(QString(QChar(0x2028)), m_current_style.char_format);
                 m_xml.skipCurrentElement();
             } else if (m_xml.qualifiedName() == "w:noBreakHyphen") {
-                m_cursor.insertText(QChar(0x2013), m_current_style.char_format);
+                m_runs.append(QString(QChar(0x2013)), m_current_style.char_format);
                 m_xml.skipCurrentElement();
             } else if (m_xml.qualifiedName() == "w:commentReference") {
                 const QString comment_id = m_xml.attributes().value("w:id").toString();
                 m_current_comment.text = m_comments.value(comment_id).text;
                 m_current_comment.author = m_comments.value(comment_id).author;
                 m_current_comment.date = m_comments.value(comment_id).date;
+                m_runs.flush(m_cursor);
                 m_current_comment.insertIfReady(m_cursor);
                 m_xml.skipCurrentElement();
             } else if (m_xml.tokenType() != QXmlStreamReader::EndElement) {
@@ -667,15 +763,11 @@ void DocxReader::readText()
 {
     bool keepws = (m_xml.attributes().value("xml:space") == "preserve");
 
-    QString text;
     while (m_xml.readNext() == QXmlStreamReader::Characters) {
         if (keepws || !m_xml.isWhitespace()) {
-            text += m_xml.text();
+            m_runs.append(m_xml.text(), m_current_style.char_format);
         }
     }
-    if (!text.isEmpty()) {
-        m_cursor.insertText(text, m_current_style.char_format);
-    }
 }
 
 //-----------------------------------------------------------------------------
@@ -20,6 +20,7 @@
 #ifndef DOCX_READER_H
 #define DOCX_READER_H
 
+#include "format_helpers.h"
 #include "format_reader.h"
 
 #include <QCoreApplication>
@@ -74,6 +75,27 @@ class DocxReader : public FormatReader
 		void insertIfReady(const QTextCursor& _cursor) const;
 	};
 
+	/**
+	 * @brief Результат разбора комментариев в фоновом потоке
+	 */
+	struct CommentsParseResult
+	{
+		QHash<QString, Comment> comments;
+		QString error;
+		qint64 elapsed = 0;
+	};
+
+	/**
+	 * @brief Результат разбора стилей в фоновом потоке
+	 */
+	struct StylesParseResult
+	{
+		QHash<QString, Style> styles;
+		Style default_style;
+		QString error;
+		qint64 elapsed = 0;
+	};
+
 public:
 	DocxReader();
 
@@ -89,7 +111,8 @@ private:
 	void readData(QIODevice* device);
 	void readContent();
 	void readStyles();
-	void readComments();
+	static StylesParseResult readStylesData(const QByteArray& data, const Style& default_style);
+	static CommentsParseResult readComments(const QByteArray& data);
 	void readDocument();
 	void readBody();
 	void readParagraph();
@@ -108,6 +131,10 @@ private:
 	QHash<QString, Comment> m_comments;
 	Comment m_current_comment;
 
+	TextRunBuffer m_runs;
+
+	qint64 m_progress_total;
+
 	bool m_in_block;
 };
 
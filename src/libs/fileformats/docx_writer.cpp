@@ -49,6 +49,7 @@ bool DocxWriter::write(QIODevice* device, const QTextDocument* document)
 	if (zip.status() != QtZipWriter::NoError) {
 		return false;
 	}
+	zip.beginBatch();
 
 	zip.addFile(QString::fromLatin1("_rels/.rels"),
 		"<?xml version=\"1.0\"?>"
@@ -6,7 +6,8 @@ DEFINES += FILEFORMATS_LIBRARY
 #
 # Build configuration
 #
-CONFIG += qt thread warn_on
+CONFIG += qt thread warn_on c++11
+QT += concurrent
 mac:CONFIG += staticlib
 
 QMAKE_MAC_SDK = macosx10.12
@@ -3,7 +3,10 @@
 
 #include "fileformatsglobal.h"
 
+#include <QHash>
+#include <QTextCursor>
 #include <QTextFormat>
+#include <QVector>
 
 
 /**
@@ -100,5 +103,159 @@ private:
 	}
 };
 
+/**
+ * @brief Буфер фрагментов текста абзаца для пакетной вставки в документ
+ *
+ * Ридеры складывают в буфер текст и формат каждого фрагмента, а в документ он
+ * попадает одной вставкой на каждый участок с одинаковым форматом. Одинаковые
+ * форматы хранятся в таблице форматов один раз на весь документ, поэтому в документ
+ * передаются общие экземпляры QTextCharFormat, которые его таблица форматов
+ * сопоставляет без сравнения свойств.
+ */
+class TextRunBuffer
+{
+public:
+	/**
+	 * @brief Добавить фрагмент текста с заданным форматом
+	 */
+	/** @{ */
+	void append(const QString& _text, const QTextCharFormat& _format) {
+		if (!_text.isEmpty()) {
+			appendRun(_text.length(), _format);
+			m_text.append(_text);
+		}
+	}
+	void append(const QStringRef& _text, const QTextCharFormat& _format) {
+		if (!_text.isEmpty()) {
+			appendRun(_text.length(), _format);
+			m_text.append(_text);
+		}
+	}
+	/** @} */
+
+	/**
+	 * @brief Позиция курсора с учётом ещё не вставленного текста
+	 * @note Буфер накапливает текст только в пределах текущего блока
+	 */
+	int position(const QTextCursor& _cursor) const {
+		return _cursor.position() + m_text.length();
+	}
+
+	/**
+	 * @brief Вставить накопленный текст в документ
+	 */
+	void flush(QTextCursor& _cursor) {
+		int start = 0;
+		for (const Run& run : m_runs) {
+			_cursor.insertText(m_text.mid(start, run.length), m_formats.at(run.format));
+			start += run.length;
+		}
+		m_runs.clear();
+		m_text.clear();
+	}
+
+	/**
+	 * @brief Очистить буфер и таблицу форматов
+	 */
+	void clear() {
+		m_runs.clear();
+		m_text.clear();
+		m_formats.clear();
+		m_formatIndexes.clear();
+		m_lastFormat = -1;
+	}
+
+private:
+	/**
+	 * @brief Учесть фрагмент заданной длины, объединив его с предыдущим при совпадении формата
+	 */
+	void appendRun(int _length, const QTextCharFormat& _format) {
+		const int formatIndex = internFormat(_format);
+		if (!m_runs.isEmpty() && m_runs.last().format == formatIndex) {
+			m_runs.last().length += _length;
+		} else {
+			m_runs.append({ formatIndex, _length });
+		}
+	}
+
+	/**
+	 * @brief Получить индекс формата в таблице, добавив его при необходимости
+	 */
+	int internFormat(const QTextCharFormat& _format) {
+		//
+		// Чаще всего соседние фрагменты оформлены одинаково, поэтому сначала
+		// проверяем последний использованный формат
+		//
+		if (m_lastFormat >= 0 && m_formats.at(m_lastFormat) == _format) {
+			return m_lastFormat;
+		}
+
+		const uint key = formatKey(_format);
+		for (auto iter = m_formatIndexes.constFind(key);
+			 iter != m_formatIndexes.constEnd() && iter.key() == key;
+			 ++iter) {
+			if (m_formats.at(iter.value()) == _format) {
+				m_lastFormat = iter.value();
+				return m_lastFormat;
+			}
+		}
+
+		m_formats.append(_format);
+		m_lastFormat = m_formats.size() - 1;
+		m_formatIndexes.insert(key, m_lastFormat);
+		return m_lastFormat;
+	}
+
+	/**
+	 * @brief Ключ формата для поиска в таблице
+	 * @note Учитываются только основные свойства, остальные различия проверяются сравнением форматов
+	 */
+	static uint formatKey(const QTextCharFormat& _format) {
+		return qHash(_format.fontFamily())
+				^ (uint(_format.propertyCount()) << 24)
+				^ (uint(qRound(_format.fontPointSize() * 4)) << 8)
+				^ (uint(_format.fontWeight()) << 1)
+				^ (_format.fontItalic() ? 0x10000u : 0)
+				^ (_format.fontUnderline() ? 0x20000u : 0)
+				^ (_format.fontStrikeOut() ? 0x40000u : 0)
+				^ _format.foreground().color().rgba()
+				^ (_format.background().color().rgba() >> 1);
+	}
+
+private:
+	/**
+	 * @brief Фрагмент текста: индекс формата и длина
+	 */
+	struct Run {
+		int format;
+		int length;
+	};
+
+	/**
+	 * @brief Фрагменты текущего блока
+	 */
+	QVector<Run> m_runs;
+
+	/**
+	 * @brief Текст текущего блока
+	 */
+	QString m_text;
+
+	/**
+	 * @brief Интернированные форматы документа
+	 */
+	QVector<QTextCharFormat> m_formats;
+
+	/**
+	 * @brief Индексы форматов в таблице по ключу формата
+	 */
+	QMultiHash<uint, int> m_formatIndexes;
+
+	/**
+	 * @brief Индекс последнего использованного формата
+	 */
+	int m_lastFormat = -1;
+};
+
 #endif // FORMAT_HELPERS
 
@@ -25,6 +25,12 @@
 #include "txt_reader.h"
 
 #include <QStringList>
+#include <QThreadStorage>
+
+namespace
+{
+	Q_GLOBAL_STATIC(QThreadStorage<FormatManager::ReaderSetup>, s_reader_setup)
+}
 
 //-----------------------------------------------------------------------------
 
@@ -60,11 +66,25 @@ FormatReader* FormatManager::createReader(QIODevice* device, const QString& type
 		}
 	}
 
+	if (s_reader_setup()->hasLocalData()) {
+		const ReaderSetup& setup = s_reader_setup()->localData();
+		if (setup) {
+			setup(reader);
+		}
+	}
+
 	return reader;
 }
 
 //-----------------------------------------------------------------------------
 
+void FormatManager::setThreadReaderSetup(const ReaderSetup& setup)
+{
+	s_reader_setup()->setLocalData(setup);
+}
+
+//-----------------------------------------------------------------------------
+
 QString FormatManager::filter(const QString& type)
 {
 	if (type == "odt") {
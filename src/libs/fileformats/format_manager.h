@@ -27,6 +27,8 @@ class FormatReader;
 #include <QCoreApplication>
 #include <QString>
 
+#include <functional>
+
 class QIODevice;
 class QStringList;
 
@@ -34,7 +36,19 @@ class QStringList;
 class FILEFORMATS_EXPORT FormatManager
 {
 public:
+	/**
+	 * @brief Настройка ридера сразу после создания
+	 */
+	typedef std::function<void (FormatReader* reader)> ReaderSetup;
+
 	static FormatReader* createReader(QIODevice* device, const QString& type = QString());
+
+	/**
+	 * @brief Установить настройку для ридеров, создаваемых в текущем потоке
+	 * @note Позволяет подключить прогресс и отмену чтения, когда ридер создаётся внутри
+	 *       кода, не дающего к нему доступа, например внутри импортёра сценария
+	 */
+	static void setThreadReaderSetup(const ReaderSetup& setup);
 	static QString filter(const QString& type);
 	static QStringList filters(const QString& type = QString());
 	static bool isRichText(const QString& filename);
@@ -22,19 +22,56 @@
 
 #include "fileformatsglobal.h"
 
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QString>
 #include <QTextCursor>
 
+#include <functional>
+
 class QIODevice;
 class QTextDocument;
 
 class FILEFORMATS_EXPORT FormatReader
 {
 public:
+	/**
+	 * @brief Обработчик прогресса чтения: сколько байт обработано и сколько всего
+	 * @note Вызывается в потоке, в котором выполняется чтение
+	 */
+	typedef std::function<void (qint64 processed, qint64 total)> ProgressHandler;
+
+	FormatReader() :
+		m_canceled(0)
+	{
+	}
+
 	virtual ~FormatReader()
 	{
 	}
 
+	/**
+	 * @brief Установить обработчик прогресса чтения
+	 */
+	void setProgressHandler(const ProgressHandler& handler)
+	{
+		m_progress_handler = handler;
+	}
+
+	/**
+	 * @brief Прервать чтение
+	 * @note Может вызываться из любого потока, ридер остановится при ближайшем отчёте о прогрессе
+	 */
+	void cancel()
+	{
+		m_canceled.storeRelease(1);
+	}
+
+	bool isCanceled() const
+	{
+		return m_canceled.loadAcquire() != 0;
+	}
+
 	QByteArray encoding() const
 	{
 		return m_encoding;
@@ -68,6 +105,27 @@ public:
 		return Type;
 	}
 
+protected:
+	/**
+	 * @brief Сообщить о прогрессе чтения
+	 * @return false, если чтение было прервано и его нужно остановить
+	 */
+	bool reportProgress(qint64 processed, qint64 total)
+	{
+		if (m_progress_handler) {
+			m_progress_handler(processed, total);
+		}
+		return !isCanceled();
+	}
+
+	/**
+	 * @brief Текст ошибки для прерванного чтения
+	 */
+	static QString canceledError()
+	{
+		return QCoreApplication::translate("FormatReader", "Reading was canceled.");
+	}
+
 protected:
 	QTextCursor m_cursor;
 	QString m_error;
@@ -75,6 +133,10 @@ protected:
 
 private:
 	virtual void readData(QIODevice* device) = 0;
+
+private:
+	ProgressHandler m_progress_handler;
+	QAtomicInt m_canceled;
 };
 
 #endif
@@ -21,6 +21,7 @@
 
 #include "qtzip/QtZipReader"
 
+#include <QScopedPointer>
 #include <QTextDocument>
 
 namespace {
@@ -34,7 +35,8 @@ namespace {
 //-----------------------------------------------------------------------------
 
 OdtReader::OdtReader() :
-	m_in_block(true)
+	m_in_block(true),
+	m_progress_total(0)
 {
 	m_xml.setNamespaceProcessing(false);
 }
@@ -53,6 +55,7 @@ void OdtReader::readData(QIODevice* device)
 {
 	m_in_block = m_cursor.document()->blockCount();
 	m_block_format = m_cursor.blockFormat();
+	m_runs.clear();
 
 	// Open archive
 	QtZipReader zip(device);
@@ -61,14 +64,16 @@ void OdtReader::readData(QIODevice* device)
 	if (zip.isReadable()) {
 		const QString files[] = { QString::fromLatin1("styles.xml"), QString::fromLatin1("content.xml") };
 		for (int i = 0; i < 2; ++i) {
-			QByteArray data = zip.fileData(files[i]);
-			if (data.isEmpty()) {
+			QScopedPointer<QIODevice> entry(zip.openFile(files[i]));
+			if (entry.isNull() || entry->size() == 0) {
 				continue;
 			}
-			m_xml.addData(data);
+			m_progress_total = entry->size();
+			m_xml.setDevice(entry.data());
 			readDocument();
 			if (m_xml.hasError()) {
 				m_error = m_xml.errorString();
+				m_xml.clear();
 				break;
 			}
 			m_xml.clear();
@@ -79,8 +84,6 @@ void OdtReader::readData(QIODevice* device)
 
 	// Close archive
 	zip.close();
-
-	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 }
 
 //-----------------------------------------------------------------------------
@@ -331,6 +334,7 @@ void OdtReader::readBody()
 			m_xml.skipCurrentElement();
 		}
 	}
+	m_runs.flush(m_cursor);
 	m_cursor.endEditBlock();
 }
 
@@ -390,12 +394,16 @@ void OdtReader::readParagraph(int level)
 		m_cursor.mergeBlockFormat(block_format);
 		m_cursor.mergeBlockCharFormat(char_format);
 	}
+	m_char_format = m_cursor.charFormat();
 
 	// Read paragraph text
 	readText();
+	m_runs.flush(m_cursor);
 	m_in_block = false;
 
-	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	if (!reportProgress(m_progress_total - m_xml.device()->bytesAvailable(), m_progress_total)) {
+		m_xml.raiseError(canceledError());
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -405,10 +413,10 @@ void OdtReader::readSpan()
 	QXmlStreamAttributes attributes = m_xml.attributes();
 
 	// Style text
-	QTextCharFormat format = m_cursor.charFormat();
+	QTextCharFormat format = m_char_format;
 	if (attributes.hasAttribute(QLatin1String("text:style-name"))) {
 		const Style& style = m_styles[1][attributes.value(QLatin1String("text:style-name")).toString()];
-		m_cursor.mergeCharFormat(style.char_format);
+		m_char_format.merge(style.char_format);
 	}
 
 	if (attributes.hasAttribute(QLatin1String("text:class-names"))) {
@@ -416,7 +424,7 @@ void OdtReader::readSpan()
 		int count = styles.count();
 		for (int i = 0; i < count; ++i) {
 			const Style& style = m_styles[1][styles.at(i)];
-			m_cursor.mergeCharFormat(style.char_format);
+			m_char_format.merge(style.char_format);
 		}
 	}
 
@@ -424,7 +432,7 @@ void OdtReader::readSpan()
 	readText();
 
 	// Restore previous style
-	m_cursor.setCharFormat(format);
+	m_char_format = format;
 }
 
 //-----------------------------------------------------------------------------
@@ -434,7 +442,7 @@ void OdtReader::readText()
 	int depth = 1;
 	while (depth && (m_xml.readNext() != QXmlStreamReader::Invalid)) {
 		if (m_xml.isCharacters()) {
-			m_cursor.insertText(m_xml.text().toString());
+			m_runs.append(m_xml.text(), m_char_format);
 		} else if (m_xml.isStartElement()) {
 			++depth;
 			if (m_xml.qualifiedName() == "text:span") {
@@ -442,11 +450,11 @@ void OdtReader::readText()
 				--depth;
 			} else if (m_xml.qualifiedName() == "text:s") {
 				int spaces = m_xml.attributes().value(QLatin1String("text:c")).toString().toInt();
-				m_cursor.insertText(QString(qMax(1, spaces), QLatin1Char(' ')));
+				m_runs.append(QString(qMax(1, spaces), QLatin1Char(' ')), m_char_format);
 			} else if (m_xml.qualifiedName() == "text:tab") {
-				m_cursor.insertText(QLatin1String("\t"));
+				m_runs.append(QString(QLatin1Char('\t')), m_char_format);
 			} else if (m_xml.qualifiedName() == "text:line-break") {
-				m_cursor.insertText(QChar(0x2028));
+				m_runs.append(QString(QChar(0x2028)), m_char_format);
 			}
 		} else if (m_xml.isEndElement()) {
 			--depth;
@@ -20,6 +20,7 @@
 #ifndef ODT_READER_H
 #define ODT_READER_H
 
+#include "format_helpers.h"
 #include "format_reader.h"
 
 #include <QCoreApplication>
@@ -70,6 +71,9 @@ private:
 	};
 	QHash<QString, Style> m_styles[2];
 	QTextBlockFormat m_block_format;
+	QTextCharFormat m_char_format;
+	TextRunBuffer m_runs;
+	qint64 m_progress_total;
 
 	bool m_in_block;
 };
@@ -43,11 +43,15 @@
 #include "qtzipwriter.h"
 #include <QDateTime>
 #include <QDir>
+#include <QHash>
 #include <QtDebug>
 #include <QtEndian>
 #include <QtGlobal>
+#include <QtConcurrent>
 #include <qplatformdefs.h>
 
+#include <limits>
+
 #ifndef Q_OS_WIN
 #include <zlib.h>
 #else
@@ -231,7 +235,7 @@ static int inflate(Bytef *dest, ulong *destLen, const Bytef *source, ulong sourc
 	return err;
 }
 
-static int deflate (Bytef *dest, ulong *destLen, const Bytef *source, ulong sourceLen)
+static int deflate (Bytef *dest, ulong *destLen, const Bytef *source, ulong sourceLen, int level)
 {
 	z_stream stream;
 	int err;
@@ -246,7 +250,7 @@ static int deflate (Bytef *dest, ulong *destLen, const Bytef *source, ulong sour
 	stream.zfree = (free_func)0;
 	stream.opaque = (voidpf)0;
 
-	err = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	err = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
 	if (err != Z_OK) return err;
 
 	err = deflate(&stream, Z_FINISH);
@@ -545,8 +549,11 @@ public:
 	}
 
 	void scanFiles();
+	int indexOf(const QString &fileName) const;
 
 	QtZipReader::Status status;
+	// lookup table from the entry name to its position in fileHeaders
+	QHash<QString, int> fileIndexes;
 };
 
 class QtZipWriterPrivate : public QtZipPrivate
@@ -556,17 +563,42 @@ public:
 		: QtZipPrivate(device, ownDev),
 		status(QtZipWriter::NoError),
 		permissions(QFile::ReadOwner | QFile::WriteOwner),
-		compressionPolicy(QtZipWriter::AlwaysCompress)
+		compressionPolicy(QtZipWriter::AlwaysCompress),
+		compressionLevel(Z_DEFAULT_COMPRESSION),
+		batchMode(false)
 	{
 	}
 
 	QtZipWriter::Status status;
 	QFile::Permissions permissions;
 	QtZipWriter::CompressionPolicy compressionPolicy;
+	int compressionLevel;
 
 	enum EntryType { Directory, File, Symlink };
 
+	// entry with its settings captured at the moment it was added,
+	// so it can be compressed later on any thread
+	struct PendingEntry
+	{
+		EntryType type;
+		QString fileName;
+		QByteArray contents;
+		QFile::Permissions permissions;
+		QtZipWriter::CompressionPolicy compressionPolicy;
+		int compressionLevel;
+		QDateTime lastModified;
+		FileHeader header;
+		QByteArray data;
+	};
+
+	bool batchMode;
+	QList<PendingEntry> pendingEntries;
+
 	void addEntry(EntryType type, const QString &fileName, const QByteArray &contents);
+	void flushEntries();
+	void writeEntry(PendingEntry &entry);
+
+	static void prepareEntry(PendingEntry &entry);
 };
 
 LocalFileHeader CentralFileHeader::toLocalHeader() const
@@ -609,22 +641,37 @@ void QtZipReaderPrivate::scanFiles()
 	}
 
 	// find EndOfDirectory header
+	// the record is followed only by the archive comment (at most 65535 bytes),
+	// so read the tail once and search it backwards in memory
+	const qint64 device_size = device->size();
+	const qint64 tail_size = qMin<qint64>(device_size, qint64(sizeof(EndOfDirectory)) + 0xffff);
+	if (tail_size < qint64(sizeof(EndOfDirectory))
+		|| !device->seek(device_size - tail_size)) {
+		qWarning() << "QtZip: EndOfDirectory not found";
+		return;
+	}
+	const QByteArray tail = device->read(tail_size);
+	if (tail.size() != tail_size) {
+		qWarning() << "QtZip: EndOfDirectory not found";
+		return;
+	}
+
 	int i = 0;
 	int start_of_directory = -1;
 	int num_dir_entries = 0;
 	EndOfDirectory eod;
-	while (start_of_directory == -1) {
-		const int pos = device->size() - int(sizeof(EndOfDirectory)) - i;
-		if (pos < 0 || i > 65535) {
+	const uchar *tail_data = (const uchar *)tail.constData();
+	const int last_pos = tail.size() - int(sizeof(EndOfDirectory));
+	for (int pos = last_pos; ; --pos) {
+		if (pos < 0) {
 			qWarning() << "QtZip: EndOfDirectory not found";
 			return;
 		}
-
-		device->seek(pos);
-		device->read((char *)&eod, sizeof(EndOfDirectory));
-		if (readUInt(eod.signature) == 0x06054b50)
+		if (tail_data[pos] == 0x50 && readUInt(tail_data + pos) == 0x06054b50) {
+			memcpy(&eod, tail_data + pos, sizeof(EndOfDirectory));
+			i = last_pos - pos;
 			break;
-		++i;
+		}
 	}
 
 	// have the eod
@@ -634,7 +681,7 @@ void QtZipReaderPrivate::scanFiles()
 	int comment_length = readUShort(eod.comment_length);
 	if (comment_length != i)
 		qWarning() << "QtZip: failed to parse zip file.";
-	comment = device->read(qMin(comment_length, i));
+	comment = tail.mid(last_pos - i + int(sizeof(EndOfDirectory)), qMin(comment_length, i));
 
 
 	device->seek(start_of_directory);
@@ -670,10 +717,179 @@ void QtZipReaderPrivate::scanFiles()
 		}
 
 		ZDEBUG("found file '%s'", header.file_name.data());
+		const QString file_name = QString::fromLocal8Bit(header.file_name);
+		if (!fileIndexes.contains(file_name))
+			fileIndexes.insert(file_name, fileHeaders.size());
 		fileHeaders.append(header);
 	}
 }
 
+int QtZipReaderPrivate::indexOf(const QString &fileName) const
+{
+	return fileIndexes.value(fileName, -1);
+}
+
+/*!
+	\internal
+	Sequential device over one archive member. Compressed data is read from
+	the archive device in chunks of ChunkSize bytes and inflated on demand.
+*/
+class QtZipEntryDevice : public QIODevice
+{
+public:
+	QtZipEntryDevice(QIODevice *archive, qint64 dataStart, qint64 compressedSize,
+					 qint64 uncompressedSize, bool deflated)
+		: archive(archive), dataStart(dataStart), compressedSize(compressedSize),
+		  uncompressedSize(uncompressedSize), deflated(deflated),
+		  consumed(0), produced(0), streamOpen(false), streamEnd(false)
+	{
+		memset(&stream, 0, sizeof(stream));
+	}
+
+	~QtZipEntryDevice()
+	{
+		close();
+	}
+
+	bool open(OpenMode mode) override
+	{
+		if ((mode & QIODevice::WriteOnly) != 0)
+			return false;
+
+		if (deflated) {
+			stream.zalloc = (alloc_func)0;
+			stream.zfree = (free_func)0;
+			stream.opaque = (voidpf)0;
+			if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+				return false;
+			streamOpen = true;
+		}
+		return QIODevice::open(mode);
+	}
+
+	void close() override
+	{
+		if (streamOpen) {
+			inflateEnd(&stream);
+			streamOpen = false;
+		}
+		QIODevice::close();
+	}
+
+	bool isSequential() const override
+	{
+		return true;
+	}
+
+	qint64 size() const override
+	{
+		return uncompressedSize;
+	}
+
+	qint64 bytesAvailable() const override
+	{
+		const qint64 left = streamEnd ? 0 : qMax<qint64>(0, uncompressedSize - produced);
+		return left + QIODevice::bytesAvailable();
+	}
+
+protected:
+	qint64 readData(char *data, qint64 maxSize) override
+	{
+		if (!deflated)
+			return readStored(data, maxSize);
+		return readDeflated(data, maxSize);
+	}
+
+	qint64 writeData(const char *, qint64) override
+	{
+		return -1;
+	}
+
+private:
+	enum { ChunkSize = 64 * 1024 };
+
+	// the archive device is shared with the reader, so always seek before reading from it
+	qint64 readCompressed(char *data, qint64 maxSize)
+	{
+		const qint64 size = qMin(maxSize, compressedSize - consumed);
+		if (size <= 0)
+			return 0;
+		if (!archive->seek(dataStart + consumed))
+			return -1;
+		const qint64 read = archive->read(data, size);
+		if (read > 0)
+			consumed += read;
+		return read;
+	}
+
+	qint64 readStored(char *data, qint64 maxSize)
+	{
+		const qint64 read = readCompressed(data, qMin(maxSize, uncompressedSize - produced));
+		if (read > 0)
+			produced += read;
+		return read;
+	}
+
+	qint64 readDeflated(char *data, qint64 maxSize)
+	{
+		if (streamEnd || maxSize <= 0)
+			return 0;
+
+		stream.next_out = (Bytef *)data;
+		stream.avail_out = (uInt)qMin<qint64>(maxSize, std::numeric_limits<uInt>::max());
+		while (stream.avail_out > 0) {
+			if (stream.avail_in == 0) {
+				if (input.isEmpty())
+					input.resize(ChunkSize);
+				const qint64 read = readCompressed(input.data(), input.size());
+				if (read < 0) {
+					setErrorString(QLatin1String("QtZip: Failed to read compressed data"));
+					return -1;
+				}
+				stream.next_in = (Bytef *)input.data();
+				stream.avail_in = (uInt)read;
+			}
+
+			const uInt before = stream.avail_out;
+			const int res = inflate(&stream, Z_NO_FLUSH);
+			if (res == Z_STREAM_END) {
+				streamEnd = true;
+				break;
+			}
+			if (res == Z_BUF_ERROR && before == stream.avail_out) {
+				// no progress is possible: the compressed data is truncated
+				qWarning("QtZip: Z_DATA_ERROR: Input data is corrupted");
+				streamEnd = true;
+				break;
+			}
+			if (res != Z_OK && res != Z_BUF_ERROR) {
+				if (res == Z_MEM_ERROR)
+					qWarning("QtZip: Z_MEM_ERROR: Not enough memory");
+				else
+					qWarning("QtZip: Z_DATA_ERROR: Input data is corrupted");
+				streamEnd = true;
+				break;
+			}
+		}
+
+		const qint64 read = (char *)stream.next_out - data;
+		produced += read;
+		return read;
+	}
+
+	QIODevice *archive;
+	const qint64 dataStart;
+	const qint64 compressedSize;
+	const qint64 uncompressedSize;
+	const bool deflated;
+	qint64 consumed;
+	qint64 produced;
+	z_stream stream;
+	bool streamOpen;
+	bool streamEnd;
+	QByteArray input;
+};
+
 void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const QByteArray &contents/*, QFile::Permissions permissions, QtZip::Method m*/)
 {
 #ifndef NDEBUG
@@ -684,29 +900,62 @@ void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
 	ZDEBUG() << "adding" << entryTypes[type] <<":" << fileName.toUtf8().data() << (type == 2 ? QByteArray(" -> " + contents).constData() : "");
 #endif
 
-	if (! (device->isOpen() || device->open(QIODevice::WriteOnly))) {
-		status = QtZipWriter::FileOpenError;
+	PendingEntry entry;
+	entry.type = type;
+	entry.fileName = fileName;
+	entry.contents = contents;
+	entry.permissions = permissions;
+	entry.compressionPolicy = compressionPolicy;
+	entry.compressionLevel = compressionLevel;
+	entry.lastModified = QDateTime::currentDateTime();
+
+	if (batchMode) {
+		pendingEntries.append(entry);
 		return;
 	}
-	device->seek(start_of_directory);
+
+	prepareEntry(entry);
+	writeEntry(entry);
+}
+
+void QtZipWriterPrivate::flushEntries()
+{
+	if (pendingEntries.isEmpty())
+		return;
+
+	// compress in parallel, but write in the order entries were added
+	// so the archive layout does not depend on thread scheduling
+	QtConcurrent::blockingMap(pendingEntries, &QtZipWriterPrivate::prepareEntry);
+	for (int i = 0; i < pendingEntries.size(); ++i)
+		writeEntry(pendingEntries[i]);
+	pendingEntries.clear();
+}
+
+void QtZipWriterPrivate::prepareEntry(PendingEntry &entry)
+{
+	const QByteArray &contents = entry.contents;
 
 	// don't compress small files
-	QtZipWriter::CompressionPolicy compression = compressionPolicy;
-	if (compressionPolicy == QtZipWriter::AutoCompress) {
+	QtZipWriter::CompressionPolicy compression = entry.compressionPolicy;
+	if (entry.compressionPolicy == QtZipWriter::AutoCompress) {
 		if (contents.length() < 64)
 			compression = QtZipWriter::NeverCompress;
 		else
 			compression = QtZipWriter::AlwaysCompress;
 	}
+	// level 0 means no compression at all, so store the data as is
+	if (entry.compressionLevel == Z_NO_COMPRESSION)
+		compression = QtZipWriter::NeverCompress;
 
-	FileHeader header;
+	FileHeader &header = entry.header;
 	memset(&header.h, 0, sizeof(CentralFileHeader));
 	writeUInt(header.h.signature, 0x02014b50);
 
 	writeUShort(header.h.version_needed, ZIP_VERSION);
 	writeUInt(header.h.uncompressed_size, contents.length());
-	writeMSDosDate(header.h.last_mod_file, QDateTime::currentDateTime());
-	QByteArray data = contents;
+	writeMSDosDate(header.h.last_mod_file, entry.lastModified);
+	QByteArray &data = entry.data;
+	data = contents;
 	if (compression == QtZipWriter::AlwaysCompress) {
 		writeUShort(header.h.compression_method, CompressionMethodDeflated);
 
@@ -716,7 +965,7 @@ void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
 		int res;
 		do {
 			data.resize(len);
-			res = deflate((uchar*)data.data(), &len, (const uchar*)contents.constData(), contents.length());
+			res = deflate((uchar*)data.data(), &len, (const uchar*)contents.constData(), contents.length(), entry.compressionLevel);
 
 			switch (res) {
 			case Z_OK:
@@ -743,7 +992,7 @@ void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
 	writeUShort(header.h.general_purpose_bits, general_purpose_bits);
 
 	const bool inUtf8 = (general_purpose_bits & Utf8Names) != 0;
-	header.file_name = inUtf8 ? fileName.toUtf8() : fileName.toLocal8Bit();
+	header.file_name = inUtf8 ? entry.fileName.toUtf8() : entry.fileName.toLocal8Bit();
 	if (header.file_name.size() > 0xffff) {
 		qWarning("QtZip: Filename is too long, chopping it to 65535 bytes");
 		header.file_name = header.file_name.left(0xffff); // ### don't break the utf-8 sequence, if any
@@ -758,22 +1007,35 @@ void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const
 	writeUShort(header.h.version_made, HostUnix << 8);
 	//uchar internal_file_attributes[2];
 	//uchar external_file_attributes[4];
-	quint32 mode = permissionsToMode(permissions);
-	switch (type) {
+	quint32 mode = permissionsToMode(entry.permissions);
+	switch (entry.type) {
 		case File: mode |= S_IFREG; break;
 		case Directory: mode |= S_IFDIR; break;
 		case Symlink: mode |= S_IFLNK; break;
 	}
 	writeUInt(header.h.external_file_attributes, mode << 16);
-	writeUInt(header.h.offset_local_header, start_of_directory);
 
+	// the source is not needed anymore, free it as early as possible
+	entry.contents = QByteArray();
+}
+
+void QtZipWriterPrivate::writeEntry(PendingEntry &entry)
+{
+	if (! (device->isOpen() || device->open(QIODevice::WriteOnly))) {
+		status = QtZipWriter::FileOpenError;
+		return;
+	}
+	device->seek(start_of_directory);
+
+	FileHeader &header = entry.header;
+	writeUInt(header.h.offset_local_header, start_of_directory);
 
 	fileHeaders.append(header);
 
 	LocalFileHeader h = header.h.toLocalHeader();
 	device->write((const char *)&h, sizeof(LocalFileHeader));
 	device->write(header.file_name);
-	device->write(data);
+	device->write(entry.data);
 	start_of_directory = device->pos();
 	dirtyFileTree = true;
 }
@@ -973,86 +1235,70 @@ QtZipReader::FileInfo QtZipReader::entryInfoAt(int index) const
 }
 
 /*!
-	Fetch the file contents from the zip archive and return the uncompressed bytes.
+	Opens the entry \a fileName of the zip archive for sequential reading.
+	The returned device inflates the entry in fixed-size chunks while it is
+	read, so the whole uncompressed content is never held in memory at once.
+	The caller takes ownership of the device, which must not outlive the reader.
+	Returns \c 0 if the entry does not exist or can not be extracted.
 */
-QByteArray QtZipReader::fileData(const QString &fileName) const
+QIODevice* QtZipReader::openFile(const QString &fileName) const
 {
 	d->scanFiles();
-	int i;
-	for (i = 0; i < d->fileHeaders.size(); ++i) {
-		if (QString::fromLocal8Bit(d->fileHeaders.at(i).file_name) == fileName)
-			break;
-	}
-	if (i == d->fileHeaders.size())
-		return QByteArray();
+	const int i = d->indexOf(fileName);
+	if (i == -1)
+		return 0;
 
 	FileHeader header = d->fileHeaders.at(i);
 
 	ushort version_needed = readUShort(header.h.version_needed);
 	if (version_needed > ZIP_VERSION) {
 		qWarning("QtZip: .ZIP specification version %d implementationis needed to extract the data.", version_needed);
-		return QByteArray();
+		return 0;
 	}
 
 	ushort general_purpose_bits = readUShort(header.h.general_purpose_bits);
-	int compressed_size = readUInt(header.h.compressed_size);
-	int uncompressed_size = readUInt(header.h.uncompressed_size);
-	int start = readUInt(header.h.offset_local_header);
-	//qDebug("uncompressing file %d: local header at %d", i, start);
+	qint64 compressed_size = readUInt(header.h.compressed_size);
+	qint64 uncompressed_size = readUInt(header.h.uncompressed_size);
+	qint64 start = readUInt(header.h.offset_local_header);
 
 	d->device->seek(start);
 	LocalFileHeader lh;
 	d->device->read((char *)&lh, sizeof(LocalFileHeader));
 	uint skip = readUShort(lh.file_name_length) + readUShort(lh.extra_field_length);
-	d->device->seek(d->device->pos() + skip);
 
 	int compression_method = readUShort(lh.compression_method);
-	//qDebug("file=%s: compressed_size=%d, uncompressed_size=%d", fileName.toLocal8Bit().data(), compressed_size, uncompressed_size);
 
 	if ((general_purpose_bits & Encrypted) != 0) {
 		qWarning("QtZip: Unsupported encryption method is needed to extract the data.");
-		return QByteArray();
+		return 0;
 	}
 
-	//qDebug("file at %lld", d->device->pos());
-	QByteArray compressed = d->device->read(compressed_size);
-	if (compression_method == CompressionMethodStored) {
-		// no compression
-		compressed.truncate(uncompressed_size);
-		return compressed;
-	} else if (compression_method == CompressionMethodDeflated) {
-		// Deflate
-		//qDebug("compressed=%d", compressed.size());
-		compressed.truncate(compressed_size);
-		QByteArray baunzip;
-		ulong len = qMax(uncompressed_size,  1);
-		int res;
-		do {
-			baunzip.resize(len);
-			res = inflate((uchar*)baunzip.data(), &len,
-						  (uchar*)compressed.constData(), compressed_size);
+	if (compression_method != CompressionMethodStored
+		&& compression_method != CompressionMethodDeflated) {
+		qWarning("QtZip: Unsupported compression method %d is needed to extract the data.", compression_method);
+		return 0;
+	}
 
-			switch (res) {
-			case Z_OK:
-				if ((int)len != baunzip.size())
-					baunzip.resize(len);
-				break;
-			case Z_MEM_ERROR:
-				qWarning("QtZip: Z_MEM_ERROR: Not enough memory");
-				break;
-			case Z_BUF_ERROR:
-				len *= 2;
-				break;
-			case Z_DATA_ERROR:
-				qWarning("QtZip: Z_DATA_ERROR: Input data is corrupted");
-				break;
-			}
-		} while (res == Z_BUF_ERROR);
-		return baunzip;
+	QtZipEntryDevice *entry = new QtZipEntryDevice(d->device, start + sizeof(LocalFileHeader) + skip,
+												   compressed_size, uncompressed_size,
+												   compression_method == CompressionMethodDeflated);
+	if (!entry->open(QIODevice::ReadOnly)) {
+		delete entry;
+		return 0;
 	}
+	return entry;
+}
 
-	qWarning("QtZip: Unsupported compression method %d is needed to extract the data.", compression_method);
-	return QByteArray();
+/*!
+	Fetch the file contents from the zip archive and return the uncompressed bytes.
+*/
+QByteArray QtZipReader::fileData(const QString &fileName) const
+{
+	QScopedPointer<QIODevice> entry(openFile(fileName));
+	if (entry.isNull())
+		return QByteArray();
+
+	return entry->readAll();
 }
 
 /*!
@@ -1288,6 +1534,55 @@ QtZipWriter::CompressionPolicy QtZipWriter::compressionPolicy() const
 	return d->compressionPolicy;
 }
 
+/*!
+	Sets the zlib compression \a level used for newly added files, from
+	0 (store without compression) through 1 (fastest) to 9 (smallest).
+	Passing -1 selects the zlib default.
+
+	\note the default level is -1
+
+	\sa compressionLevel()
+	\sa addFile()
+*/
+void QtZipWriter::setCompressionLevel(int level)
+{
+	d->compressionLevel = qBound(Z_DEFAULT_COMPRESSION, level, Z_BEST_COMPRESSION);
+}
+
+/*!
+	 Returns the currently set compression level.
+	\sa setCompressionLevel()
+*/
+int QtZipWriter::compressionLevel() const
+{
+	return d->compressionLevel;
+}
+
+/*!
+	Starts a batch of entries. Entries added after this call are only queued;
+	they are compressed in parallel on the global thread pool and written to
+	the archive in the order they were added when endBatch() or close() is
+	called.
+
+	\sa endBatch()
+*/
+void QtZipWriter::beginBatch()
+{
+	d->batchMode = true;
+}
+
+/*!
+	Compresses and writes all entries queued since beginBatch() and returns
+	to adding entries one by one.
+
+	\sa beginBatch()
+*/
+void QtZipWriter::endBatch()
+{
+	d->flushEntries();
+	d->batchMode = false;
+}
+
 /*!
 	Sets the permissions that will be used for newly added files.
 
@@ -1381,6 +1676,8 @@ void QtZipWriter::addSymLink(const QString &fileName, const QString &destination
 */
 void QtZipWriter::close()
 {
+	endBatch();
+
 	if (!(d->device->openMode() & QIODevice::WriteOnly)) {
 		d->device->close();
 		return;
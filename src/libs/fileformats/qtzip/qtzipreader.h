@@ -86,6 +86,7 @@ public:
 	int count() const;
 
 	FileInfo entryInfoAt(int index) const;
+	QIODevice* openFile(const QString &fileName) const;
 	QByteArray fileData(const QString &fileName) const;
 	bool extractAll(const QString &destinationDir) const;
 
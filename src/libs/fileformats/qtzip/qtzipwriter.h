@@ -80,6 +80,12 @@ public:
 	void setCompressionPolicy(CompressionPolicy policy);
 	CompressionPolicy compressionPolicy() const;
 
+	void setCompressionLevel(int level);
+	int compressionLevel() const;
+
+	void beginBatch();
+	void endBatch();
+
 	void setCreationPermissions(QFile::Permissions permissions);
 	QFile::Permissions creationPermissions() const;
 
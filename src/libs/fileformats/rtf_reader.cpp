@@ -28,6 +28,9 @@
 #include <QTextBlock>
 #include <QTextCodec>
 #include <QTextDecoder>
+#include <QVector>
+
+#include <cstring>
 
 //-----------------------------------------------------------------------------
 
@@ -58,6 +61,104 @@ namespace
 		qreal pixels = inches * 96.0;
 		return pixels;
 	}
+
+	// Control words known to the function tables, interned into integer ids.
+	// Names are looked up through a perfect hash built over all registered
+	// words, so a control word token costs one probe and one comparison
+	class ControlWordTable
+	{
+	public:
+		ControlWordTable() :
+			m_seed(0),
+			m_mask(0),
+			m_is_built(false)
+		{
+		}
+
+		int count() const
+		{
+			return m_names.size();
+		}
+
+		int intern(const QByteArray& name)
+		{
+			const int id = m_names.indexOf(name);
+			if (id != -1) {
+				return id;
+			}
+			m_names.append(name);
+			m_is_built = false;
+			return m_names.size() - 1;
+		}
+
+		void build()
+		{
+			if (m_is_built) {
+				return;
+			}
+
+			// Start with about n^2/2 slots, where a random seed is collision free
+			// with even odds, and grow the table if no seed fits
+			int slot_count = 64;
+			while (slot_count < (m_names.size() * m_names.size()) / 2) {
+				slot_count *= 2;
+			}
+			forever {
+				for (quint32 seed = 0; seed < 64; ++seed) {
+					m_slots.fill(EMPTY_SLOT, slot_count);
+					m_mask = slot_count - 1;
+					m_seed = seed;
+					bool is_perfect = true;
+					for (int id = 0; id < m_names.size(); ++id) {
+						const QByteArray& name = m_names.at(id);
+						quint16& slot = m_slots[hash(name.constData(), name.size()) & m_mask];
+						if (slot != EMPTY_SLOT) {
+							is_perfect = false;
+							break;
+						}
+						slot = quint16(id);
+					}
+					if (is_perfect) {
+						m_is_built = true;
+						return;
+					}
+				}
+				slot_count *= 2;
+			}
+		}
+
+		int find(const char* data, int size) const
+		{
+			Q_ASSERT(m_is_built);
+			const quint16 id = m_slots.at(hash(data, size) & m_mask);
+			if (id == EMPTY_SLOT) {
+				return -1;
+			}
+			const QByteArray& name = m_names.at(id);
+			return (name.size() == size && memcmp(name.constData(), data, size) == 0) ? id : -1;
+		}
+
+	private:
+		quint32 hash(const char* data, int size) const
+		{
+			// FNV-1a
+			quint32 result = 2166136261u ^ m_seed;
+			for (int i = 0; i < size; ++i) {
+				result = (result ^ uchar(data[i])) * 16777619u;
+			}
+			return result ^ (result >> 15);
+		}
+
+	private:
+		enum { EMPTY_SLOT = 0xffff };
+
+		QVector<QByteArray> m_names;
+		QVector<quint16> m_slots;
+		quint32 m_seed;
+		quint32 m_mask;
+		bool m_is_built;
+	}
+	control_words;
 }
 
 //-----------------------------------------------------------------------------
@@ -67,18 +168,19 @@ class RtfReader::FunctionTable
 public:
 	FunctionTable() :
 		m_group_end_func(0),
-		m_insert_text_func(0)
+		m_insert_text_func(0),
+		m_count(0)
 	{
 	}
 
 	void call(RtfReader* reader, const RtfTokenizer& token) const
 	{
-		m_functions[token.text()].call(reader, token);
-	}
-
-	bool contains(const QByteArray& name) const
-	{
-		return m_functions.contains(name);
+		// The key is a view into the tokenizer input, interned into the control word id
+		const QByteArray name = token.text();
+		const int id = control_words.find(name.constData(), name.size());
+		if (id != -1 && id < m_functions.size() && m_functions.at(id).isSet()) {
+			m_functions.at(id).call(reader, token);
+		}
 	}
 
 	void groupEnd(RtfReader* reader) const
@@ -95,12 +197,19 @@ public:
 
 	bool isEmpty() const
 	{
-		return m_functions.isEmpty();
+		return m_count == 0;
 	}
 
 	void set(const QByteArray& name, void (RtfReader::*func)(qint32), qint32 value = 0)
 	{
-		m_functions[name] = Function(func, value);
+		const int id = control_words.intern(name);
+		if (id >= m_functions.size()) {
+			m_functions.resize(id + 1);
+		}
+		if (!m_functions.at(id).isSet()) {
+			++m_count;
+		}
+		m_functions[id] = Function(func, value);
 	}
 
 	void setGroupEnd(void (RtfReader::*groupEndFunc)())
@@ -115,7 +224,11 @@ public:
 
 	void unset(const QByteArray& name)
 	{
-		m_functions.remove(name);
+		const int id = control_words.intern(name);
+		if (id < m_functions.size() && m_functions.at(id).isSet()) {
+			m_functions[id] = Function();
+			--m_count;
+		}
 	}
 
 private:
@@ -131,6 +244,11 @@ private:
 		{
 		}
 
+		bool isSet() const
+		{
+			return m_func != 0;
+		}
+
 		void call(RtfReader* reader, const RtfTokenizer& token) const
 		{
 			(reader->*m_func)(token.hasValue() ? token.value() : m_value);
@@ -140,7 +258,8 @@ private:
 		void (RtfReader::*m_func)(qint32);
 		qint32 m_value;
 	};
-	QHash<QByteArray, Function> m_functions;
+	QVector<Function> m_functions;
+	int m_count;
 }
 functions,
 stylesheet_functions,
@@ -296,6 +415,8 @@ RtfReader::RtfReader() :
 		heading_functions.unset("b");
 	}
 
+	control_words.build();
+
 	m_state.ignore_control_word = false;
 	m_state.ignore_text = false;
 	m_state.skip = 1;
@@ -346,9 +467,17 @@ void RtfReader::readData(QIODevice* device)
 		}
 
 		// Parse file contents
+		int reported_position = 0;
 		while (!m_states.isEmpty() && m_token.hasNext()) {
 			m_token.readNext();
 
+			if (m_token.position() - reported_position >= 0x10000) {
+				reported_position = m_token.position();
+				if (!reportProgress(reported_position, m_token.size())) {
+					throw canceledError();
+				}
+			}
+
 			if ((m_token.type() != EndGroupToken) && !m_in_block) {
 				m_cursor.insertBlock(m_state.block_format);
 				m_in_block = true;
@@ -360,7 +489,7 @@ void RtfReader::readData(QIODevice* device)
 				m_state.functions->groupEnd(this);
 				popState();
 			} else if (m_token.type() == ControlWordToken) {
-				if (!m_state.ignore_control_word && m_state.functions->contains(m_token.text())) {
+				if (!m_state.ignore_control_word) {
 					m_state.functions->call(this, m_token);
 				}
 			} else if (m_token.type() == TextToken) {
@@ -369,10 +498,14 @@ void RtfReader::readData(QIODevice* device)
 				}
 			}
 		}
+		reportProgress(m_token.size(), m_token.size());
 	} catch (const QString& error) {
 		m_error = error;
 	}
 	m_cursor.endEditBlock();
+
+	// Release the input, token views are not used past this point
+	m_token.setDevice(0);
 }
 
 //-----------------------------------------------------------------------------
@@ -24,26 +24,68 @@
 
 #include "rtf_tokenizer.h"
 
-#include <QCoreApplication>
+#include <QFile>
 #include <QIODevice>
 
+#include <climits>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	inline bool isLetter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	inline bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline int hexValue(char c)
+	{
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+}
+
 //-----------------------------------------------------------------------------
 
 RtfTokenizer::RtfTokenizer() :
 	m_device(0),
-	m_position(0),
+	m_mapped_file(0),
+	m_mapped_data(0),
+	m_data(0),
+	m_size(0),
+	m_position(-1),
+	m_text_start(0),
+	m_text_size(0),
 	m_value(0),
 	m_has_value(false)
 {
-	m_buffer.reserve(8192);
-	m_text.reserve(8192);
+	m_hex.reserve(1);
+}
+
+//-----------------------------------------------------------------------------
+
+RtfTokenizer::~RtfTokenizer()
+{
+	unmap();
 }
 
 //-----------------------------------------------------------------------------
 
 bool RtfTokenizer::hasNext() const
 {
-	return (m_position < m_buffer.size() - 1) || !m_device->atEnd();
+	return m_position < m_size - 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -52,8 +94,9 @@ void RtfTokenizer::readNext()
 {
 	// Reset values
 	m_type = TextToken;
-	m_hex.clear();
-	m_text.resize(0);
+	m_hex.resize(0);
+	m_text_start = 0;
+	m_text_size = 0;
 	m_value = 0;
 	m_has_value = false;
 	if (!m_device) {
@@ -75,26 +118,32 @@ void RtfTokenizer::readNext()
 		m_type = ControlWordToken;
 
 		c = next();
+		m_text_start = m_position;
 
-		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+		if (isLetter(c)) {
 			// Read control word
-			while ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-				m_text.append(c);
+			while (isLetter(c)) {
 				c = next();
 			}
+			m_text_size = m_position - m_text_start;
 
 			// Read integer value
 			int sign = (c != '-') ? 1 : -1;
 			if (sign == -1) {
 				c = next();
 			}
-			QByteArray value;
-			while (isdigit(c)) {
-				value.append(c);
+			// Long digit runs stop accumulating once out of range and are
+			// read as 0, like QByteArray::toInt() does
+			qint64 value = 0;
+			while (isDigit(c)) {
+				m_has_value = true;
+				if (value <= INT_MAX) {
+					value = value * 10 + (c - '0');
+				}
 				c = next();
 			}
-			m_has_value = !value.isEmpty();
-			m_value = value.toInt() * sign;
+			value *= sign;
+			m_value = (value >= INT_MIN && value <= INT_MAX) ? qint32(value) : 0;
 
 			// Eat space after control word
 			if (c != ' ') {
@@ -102,32 +151,33 @@ void RtfTokenizer::readNext()
 			}
 
 			// Eat binary value
-			if (m_text == "bin") {
+			if (m_text_size == 3 && memcmp(m_data + m_text_start, "bin", 3) == 0) {
 				if (m_value > 0) {
-					for (int i = 0; i < m_value; i++) {
-						c = next();
+					if (m_value > m_size - 1 - m_position) {
+						throw tr("Unexpectedly reached end of file.");
 					}
+					m_position += m_value;
 				}
 				return readNext();
 			}
 		} else if (c == '\'') {
-			// Read hexadecimal value
-			m_text.append(c);
-			QByteArray hex(2, 0);
-			hex[0] = next();
-			hex[1] = next();
-			m_hex.append(hex.toInt(0, 16));
+			// Read hexadecimal value, a malformed one is read as 0
+			m_text_size = 1;
+			const int high = hexValue(next());
+			const int low = hexValue(next());
+			m_hex.append((high != -1 && low != -1) ? char((high << 4) | low) : char(0));
 		} else {
 			// Read escaped character
-			m_text.append(c);
+			m_text_size = 1;
 		}
 	} else {
 		// Read text
 		m_type = TextToken;
+		m_text_start = m_position;
 		while (c != '\\' && c != '{' && c != '}' && c != '\n' && c != '\r') {
-			m_text.append(c);
 			c = next();
 		}
+		m_text_size = m_position - m_text_start;
 		m_position--;
 	}
 }
@@ -136,25 +186,58 @@ void RtfTokenizer::readNext()
 
 void RtfTokenizer::setDevice(QIODevice* device)
 {
+	unmap();
+	m_buffer.clear();
+	m_data = 0;
+	m_size = 0;
+	m_position = -1;
+
 	m_device = device;
+	if (!m_device) {
+		return;
+	}
+
+	// Work over the whole input at once: map files into memory when possible,
+	// otherwise read everything into a single buffer
+	QFile* file = qobject_cast<QFile*>(m_device);
+	if (file && !file->isSequential()) {
+		const qint64 offset = file->pos();
+		const qint64 size = file->size() - offset;
+		if (size > 0 && size < INT_MAX) {
+			m_mapped_data = file->map(offset, size);
+			if (m_mapped_data) {
+				m_mapped_file = file;
+				m_data = reinterpret_cast<const char*>(m_mapped_data);
+				m_size = size;
+				return;
+			}
+		}
+	}
+
+	m_buffer = m_device->readAll();
+	m_data = m_buffer.constData();
+	m_size = m_buffer.size();
 }
 
 //-----------------------------------------------------------------------------
 
 char RtfTokenizer::next()
 {
-	m_position++;
-	if (m_position >= m_buffer.size()) {
-		m_buffer.resize(8192);
-		int size = m_device->read(m_buffer.data(), m_buffer.size());
-		if (size < 1) {
-			throw tr("Unexpectedly reached end of file.");
-		}
-		m_buffer.resize(size);
-		m_position = 0;
-		QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	if (++m_position >= m_size) {
+		throw tr("Unexpectedly reached end of file.");
+	}
+	return m_data[m_position];
+}
+
+//-----------------------------------------------------------------------------
+
+void RtfTokenizer::unmap()
+{
+	if (m_mapped_file && m_mapped_data) {
+		m_mapped_file->unmap(m_mapped_data);
 	}
-	return m_buffer.at(m_position);
+	m_mapped_file = 0;
+	m_mapped_data = 0;
 }
 
 //-----------------------------------------------------------------------------
@@ -22,6 +22,7 @@
 
 #include <QByteArray>
 #include <QCoreApplication>
+class QFile;
 class QIODevice;
 
 enum RtfTokenType
@@ -38,6 +39,7 @@ class RtfTokenizer
 
 public:
 	RtfTokenizer();
+	~RtfTokenizer();
 
 	bool hasNext() const;
 	bool hasValue() const;
@@ -45,21 +47,29 @@ public:
 	QByteArray text() const;
 	RtfTokenType type() const;
 	qint32 value() const;
+	int position() const;
+	int size() const;
 
 	void readNext();
 	void setDevice(QIODevice* device);
 
 private:
 	char next();
+	void unmap();
 
 private:
 	QIODevice* m_device;
+	QFile* m_mapped_file;
+	uchar* m_mapped_data;
 	QByteArray m_buffer;
+	const char* m_data;
+	int m_size;
 	int m_position;
 
 	RtfTokenType m_type;
 	QByteArray m_hex;
-	QByteArray m_text;
+	int m_text_start;
+	int m_text_size;
 	qint32 m_value;
 	bool m_has_value;
 };
@@ -76,7 +86,8 @@ inline QByteArray RtfTokenizer::hex() const
 
 inline QByteArray RtfTokenizer::text() const
 {
-	return m_text;
+	// Token text is a view into the input, valid until the next setDevice()
+	return QByteArray::fromRawData(m_data + m_text_start, m_text_size);
 }
 
 inline RtfTokenType RtfTokenizer::type() const
@@ -89,4 +100,14 @@ inline qint32 RtfTokenizer::value() const
 	return m_value;
 }
 
+inline int RtfTokenizer::position() const
+{
+	return m_position + 1;
+}
+
+inline int RtfTokenizer::size() const
+{
+	return m_size;
+}
+
 #endif
@@ -19,9 +19,144 @@
 
 #include "txt_reader.h"
 
-#include <QCoreApplication>
+#include <QIODevice>
+#include <QScopedPointer>
 #include <QTextCodec>
-#include <QTextStream>
+#include <QTextDecoder>
+
+#include <climits>
+#include <cstring>
+
+//-----------------------------------------------------------------------------
+
+namespace
+{
+	const int READ_CHUNK_SIZE = 0x10000;
+	const int SNIFF_BLOCK_SIZE = 0x10000;
+
+	// Share of malformed sequences up to which text is still decoded as UTF-8,
+	// e.g. a file cut in the middle of a character or with a few stray bytes
+	const int UTF8_MAX_INVALID_PERCENT = 2;
+
+	// Counts malformed and multibyte UTF-8 sequences, skipping ASCII eight bytes at a time;
+	// a sequence cut by the end of a block that is not the end of the file is not counted
+	void countUtf8Sequences(const QByteArray& data, bool at_end, int& invalid, int& multibyte)
+	{
+		invalid = 0;
+		multibyte = 0;
+		const uchar* pos = reinterpret_cast<const uchar*>(data.constData());
+		const uchar* end = pos + data.size();
+		while (pos < end) {
+			if (end - pos >= 8) {
+				quint64 word;
+				memcpy(&word, pos, sizeof(word));
+				if ((word & Q_UINT64_C(0x8080808080808080)) == 0) {
+					pos += 8;
+					continue;
+				}
+			}
+
+			const uchar c = *pos;
+			int length = 0;
+			if (c < 0x80) {
+				++pos;
+				continue;
+			} else if (c >= 0xc2 && c <= 0xdf) {
+				length = 2;
+			} else if (c >= 0xe0 && c <= 0xef) {
+				length = 3;
+			} else if (c >= 0xf0 && c <= 0xf4) {
+				length = 4;
+			} else {
+				++invalid;
+				++pos;
+				continue;
+			}
+			int i = 1;
+			while (i < length && pos + i < end && (pos[i] & 0xc0) == 0x80) {
+				++i;
+			}
+			if (i < length) {
+				if (pos + i == end && !at_end) {
+					break;
+				}
+				++invalid;
+			} else {
+				++multibyte;
+			}
+			pos += i;
+		}
+	}
+
+	// Returns true if data is UTF-8 with at most a small share of malformed sequences
+	bool isMostlyUtf8(const QByteArray& data, bool at_end)
+	{
+		int invalid = 0;
+		int multibyte = 0;
+		countUtf8Sequences(data, at_end, invalid, multibyte);
+		return (invalid == 0) || (invalid * 100 <= (invalid + multibyte) * UTF8_MAX_INVALID_PERCENT);
+	}
+
+	// Scores how much the decoded text looks like Russian: common lowercase
+	// letters weigh more than rare ones and uppercase; a Cyrillic letter next
+	// to a Latin one is penalized, as it is what accented Western letters turn
+	// into when decoded with a Cyrillic codec (e.g. "caf\xe9" becomes "cafй")
+	int cyrillicScore(const QString& text)
+	{
+		static const QString frequent = QString::fromUtf8("оеаинтсрвлкмдпу");
+		int score = 0;
+		for (int i = 0; i < text.length(); ++i) {
+			const QChar c = text.at(i);
+			if (c.unicode() < 0x0400 || c.unicode() > 0x04ff) {
+				continue;
+			}
+			if (frequent.contains(c)) {
+				score += 3;
+			} else if (c.isLower()) {
+				score += 1;
+			} else {
+				score -= 1;
+			}
+			const QChar previous = (i > 0) ? text.at(i - 1) : QChar();
+			const QChar next = (i + 1 < text.length()) ? text.at(i + 1) : QChar();
+			if ((previous.unicode() < 0x80 && previous.isLetter())
+					|| (next.unicode() < 0x80 && next.isLetter())) {
+				score -= 3;
+			}
+		}
+		return score;
+	}
+
+	// Picks the codec for text without BOM that is not UTF-8; a Cyrillic codec
+	// is chosen only if its text scores at least one point per high-bit byte,
+	// otherwise the locale codec is used
+	QTextCodec* sniffCodec(const QByteArray& block)
+	{
+		const char* candidates[] = { "Windows-1251", "KOI8-R", "IBM 866" };
+
+		int high_bit_bytes = 0;
+		for (const char c : block) {
+			if (uchar(c) >= 0x80) {
+				++high_bit_bytes;
+			}
+		}
+
+		QTextCodec* best_codec = 0;
+		int best_score = 0;
+		for (const char* name : candidates) {
+			QTextCodec* codec = QTextCodec::codecForName(name);
+			if (!codec) {
+				continue;
+			}
+			const int score = cyrillicScore(codec->toUnicode(block));
+			if (score > best_score) {
+				best_score = score;
+				best_codec = codec;
+			}
+		}
+		return (best_codec && best_score >= high_bit_bytes) ? best_codec : QTextCodec::codecForLocale();
+	}
+}
 
 //-----------------------------------------------------------------------------
 
@@ -33,22 +168,43 @@ TxtReader::TxtReader()
 
 void TxtReader::readData(QIODevice* device)
 {
-	m_cursor.beginEditBlock();
+	const qint64 total = device->size();
 
-	QTextStream stream(device);
-	QTextCodec* codec = QTextCodec::codecForUtfText(device->peek(4), NULL);
-	if (codec != NULL) {
-		m_encoding = codec->name().toUpper();
-	} else {
-		codec = QTextCodec::codecForName("UTF-8");
+	// Detect the encoding from the first block: BOM first, then UTF-8 validation,
+	// then statistical sniffing
+	QByteArray chunk = device->read(SNIFF_BLOCK_SIZE);
+	QTextCodec* codec = QTextCodec::codecForUtfText(chunk.left(4), NULL);
+	if (codec == NULL) {
+		if (isMostlyUtf8(chunk, device->atEnd())) {
+			codec = QTextCodec::codecForName("UTF-8");
+		} else {
+			codec = sniffCodec(chunk);
+		}
 	}
-	stream.setCodec(codec);
+	m_encoding = codec->name().toUpper();
 
-	while (!stream.atEnd()) {
-		m_cursor.insertText(stream.read(0x4000));
-		QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	// Decode chunk by chunk with a stateful decoder, so a character split
+	// between chunks is kept; the UTF-8 decoder converts ASCII runs with SIMD
+	// and replaces malformed sequences rather than rejecting the whole file
+	QScopedPointer<QTextDecoder> decoder(codec->makeDecoder());
+	QString text;
+	if (total > 0 && total < INT_MAX) {
+		text.reserve(int(total));
+	}
+	qint64 processed = 0;
+	while (!chunk.isEmpty()) {
+		text += decoder->toUnicode(chunk);
+		processed += chunk.size();
+		if (!reportProgress(processed, total)) {
+			m_error = canceledError();
+			return;
+		}
+		chunk = device->read(READ_CHUNK_SIZE);
 	}
 
+	// Insert once
+	m_cursor.beginEditBlock();
+	m_cursor.insertText(text);
 	m_cursor.endEditBlock();
 }
 
@@ -4,7 +4,7 @@ TEMPLATE = lib
 #
 # Build configuration
 #
-CONFIG += qt thread warn_on
+CONFIG += qt thread warn_on c++11
 mac:CONFIG += staticlib
 QT -= core gui
 
@@ -79,6 +79,7 @@ HEADERS += \
 	src/hunspell/hunzip.hxx \
 	src/hunspell/w_char.hxx \
 	src/hunspell/replist.hxx \
+	src/hunspell/spellcache.hxx \
 	src/hunspell/hunvisapi.h
 
 #
@@ -98,4 +99,5 @@ SOURCES += \
 	src/hunspell/filemgr.cxx \
 	src/hunspell/hunzip.cxx \
 	src/hunspell/replist.cxx \
+	src/hunspell/spellcache.cxx \
 	src/hunspell/utf_info.cxx
@@ -5,11 +5,164 @@
 #include <string.h>
 #include <stdio.h> 
 #include <ctype.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "hashmgr.hxx"
 #include "csutil.hxx"
 #include "atypes.hxx"
 
+// compiled dictionary: the hash table of the dic file stored in a flat file
+// next to it, with pointers replaced by file offsets (see save_compiled)
+#define COMPILED_EXT ".cdic"
+#define COMPILED_MAGIC "HUNCDIC"
+#define COMPILED_VERSION 1
+#define COMPILED_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+struct compiled_header
+{
+  char      magic[8];
+  int       version;
+  int       ptrsize;    // layout of the records depends on the platform
+  int       entrysize;
+  int       tablesize;
+  int       numaliasf;
+  int       numaliasm;
+  long long dicsize;    // size and modification time of the source files
+  long long dicmtime;
+  long long affsize;
+  long long affmtime;
+  long long tableoff;   // hash table: offsets of the first records of the chains
+  long long entriesoff; // records: hentry with word and optional data
+  long long flagsoff;   // affix flag vectors
+  long long filesize;
+};
+
+// word records are allocated from a chain of large blocks, which are released
+// all at once with the hash table (the blocks grow up to ARENA_BLOCK_MAX)
+#define ARENA_BLOCK_MIN (64 * 1024)
+#define ARENA_BLOCK_MAX (4 * 1024 * 1024)
+
+struct arena_block
+{
+  struct arena_block * next;
+  size_t               size;
+  size_t               used;
+};
+
+#define ARENA_HEADER COMPILED_ALIGN(sizeof(struct arena_block))
+
+struct ptr_index
+{
+  const void * ptr;
+  int          index;
+};
+
+static int ptr_index_cmp(const void * a, const void * b)
+{
+  const char * pa = (const char *) ((const struct ptr_index *) a)->ptr;
+  const char * pb = (const char *) ((const struct ptr_index *) b)->ptr;
+  return (pa < pb) ? -1 : ((pa > pb) ? 1 : 0);
+}
+
+// sorted pointer -> index table of the alias vectors
+static struct ptr_index * make_ptr_index(void ** ptrs, int n)
+{
+  if (!n) return NULL;
+  struct ptr_index * idx = (struct ptr_index *) malloc(n * sizeof(struct ptr_index));
+  if (!idx) return NULL;
+  for (int i = 0; i < n; i++) {
+    idx[i].ptr = ptrs[i];
+    idx[i].index = i;
+  }
+  qsort(idx, n, sizeof(struct ptr_index), ptr_index_cmp);
+  return idx;
+}
+
+static int find_ptr_index(struct ptr_index * idx, int n, const void * ptr)
+{
+  if (!idx) return -1;
+  struct ptr_index key;
+  key.ptr = ptr;
+  struct ptr_index * res =
+    (struct ptr_index *) bsearch(&key, idx, n, sizeof(struct ptr_index), ptr_index_cmp);
+  return res ? res->index : -1;
+}
+
+static int file_stamp(const char * path, long long * size, long long * mtime)
+{
+  struct stat st;
+  if (!path || stat(path, &st) != 0) return 1;
+  *size = (long long) st.st_size;
+  *mtime = (long long) st.st_mtime;
+  return 0;
+}
+
+// size of the record of the word in the compiled dictionary
+static size_t compiled_entry_size(const struct hentry * hp)
+{
+  size_t wl = strlen(hp->word);
+  size_t size = sizeof(struct hentry) + (wl > hp->blen ? wl : hp->blen);
+  if (hp->var & H_OPT) {
+    size += (hp->var & H_OPT_ALIASM) ? sizeof(char *) : strlen(HENTRY_DATA2(hp)) + 1;
+  }
+  return COMPILED_ALIGN(size);
+}
+
+// private copy-on-write mapping of the file, records are relocated in place
+static char * map_file(const char * path, size_t * size)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return NULL;
+  LARGE_INTEGER fsize;
+  if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0) {
+    CloseHandle(file);
+    return NULL;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping) return NULL;
+  char * p = (char *) MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!p) return NULL;
+  *size = (size_t) fsize.QuadPart;
+  return p;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void * p = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return NULL;
+  *size = (size_t) st.st_size;
+  return (char *) p;
+#endif
+}
+
+static void unmap_file(char * p, size_t size)
+{
+#ifdef _WIN32
+  (void) size;
+  UnmapViewOfFile(p);
+#else
+  munmap(p, size);
+#endif
+}
+
 // build a hash table from a munched word list
 
 HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
@@ -30,9 +183,26 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
   aliasf = NULL;
   numaliasm = 0;
   aliasm = NULL;
+  compiled = NULL;
+  compiledsize = 0;
+  arena = NULL;
   forbiddenword = FORBIDDENWORD; // forbidden word signing flag
   load_config(apath, key);
-  int ec = load_tables(tpath, key);
+  // encrypted dictionaries are never stored in compiled (plain) form
+  char * cpath = NULL;
+  if (!key && tpath) {
+    cpath = (char *) malloc(strlen(tpath) + strlen(COMPILED_EXT) + 1);
+    if (cpath) {
+      strcpy(cpath, tpath);
+      strcat(cpath, COMPILED_EXT);
+    }
+  }
+  int ec = 0;
+  if (!cpath || load_compiled(tpath, apath, cpath)) {
+    ec = load_tables(tpath, key);
+    if (!ec && cpath) save_compiled(tpath, apath, cpath);
+  }
+  if (cpath) free(cpath);
   if (ec) {
     /* error condition - what should we do here */
     HUNSPELL_WARNING(stderr, "Hash Manager Error : %d\n",ec);
@@ -41,28 +211,19 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
       tableptr = NULL;
     }
     tablesize = 0;
+    free_arena();
   }
 }
 
 
 HashMgr::~HashMgr()
 {
-  if (tableptr) {
-    // now pass through hash table freeing up everything
-    // go through column by column of the table
-    for (int i=0; i < tablesize; i++) {
-      struct hentry * pt = tableptr[i];
-      struct hentry * nt = NULL;
-      while(pt) {
-        nt = pt->next;
-        if (pt->astr && (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen))) free(pt->astr);
-        free(pt);
-        pt = nt;
-      }
-    }
-    free(tableptr);
-  }
+  // word records and flag vectors live in the arena or in the compiled
+  // dictionary, so they are released without walking the hash table
+  if (tableptr && !is_compiled(tableptr)) free(tableptr);
   tablesize = 0;
+  free_arena();
+  free_compiled();
 
   if (aliasf) {
     for (int j = 0; j < (numaliasf); j++) free(aliasf[j]);
@@ -119,7 +280,7 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
     int descl = desc ? (aliasm ? sizeof(short) : strlen(desc) + 1) : 0;
     // variable-length hash record with word and optional fields
     struct hentry* hp = 
-	(struct hentry *) malloc (sizeof(struct hentry) + wbl + descl);
+	(struct hentry *) arena_alloc(sizeof(struct hentry) + wbl + descl, sizeof(void *));
     if (!hp) return 1;
     char * hpw = hp->word;
     strcpy(hpw, word);
@@ -169,10 +330,8 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
     	    // remove hidden onlyupcase homonym
             if (!onlyupcase) {
 		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
 		    dp->astr = hp->astr;
 		    dp->alen = hp->alen;
-		    free(hp);
 		    return 0;
 		} else {
     		    dp->next_homonym = hp;
@@ -187,10 +346,8 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
     	    // remove hidden onlyupcase homonym
             if (!onlyupcase) {
 		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
 		    dp->astr = hp->astr;
 		    dp->alen = hp->alen;
-		    free(hp);
 		    return 0;
 		} else {
     		    dp->next_homonym = hp;
@@ -199,12 +356,9 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
         	upcasehomonym = true;
             }
        }
+       // (a dropped hidden onlyupcase homonym stays in the arena)
        if (!upcasehomonym) {
     	    dp->next = hp;
-       } else {
-    	    // remove hidden onlyupcase homonym
-    	    if (hp->astr) free(hp->astr);
-    	    free(hp);
        }
     return 0;
 }     
@@ -218,7 +372,8 @@ int HashMgr::add_hidden_capitalized_word(char * word, int wbl, int wcl,
     if (((captype == HUHCAP) || (captype == HUHINITCAP) ||
       ((captype == ALLCAP) && (flags != NULL))) &&
       !((flags != NULL) && TESTAFF(flags, forbiddenword, al))) {
-          unsigned short * flags2 = (unsigned short *) malloc (sizeof(unsigned short) * (al+1));
+          unsigned short * flags2 =
+            (unsigned short *) arena_alloc(sizeof(unsigned short) * (al+1), sizeof(unsigned short));
 	  if (!flags2) return 1;
           if (al) memcpy(flags2, flags, al * sizeof(unsigned short));
           flags2[al] = ONLYUPCASEFLAG;
@@ -260,7 +415,7 @@ int HashMgr::remove(const char * word)
     while (dp) {
         if (dp->alen == 0 || !TESTAFF(dp->astr, forbiddenword, dp->alen)) {
             unsigned short * flags =
-                (unsigned short *) malloc(sizeof(short) * (dp->alen + 1));
+                (unsigned short *) arena_alloc(sizeof(short) * (dp->alen + 1), sizeof(short));
             if (!flags) return 1;
             for (int i = 0; i < dp->alen; i++) flags[i] = dp->astr[i];
             flags[dp->alen] = forbiddenword;
@@ -282,7 +437,7 @@ int HashMgr::remove_forbidden_flag(const char * word) {
             if (dp->alen == 1) dp->alen = 0; // XXX forbidden words of personal dic.
             else {
                 unsigned short * flags2 =
-                    (unsigned short *) malloc(sizeof(short) * (dp->alen - 1));
+                    (unsigned short *) arena_alloc(sizeof(short) * (dp->alen - 1), sizeof(short));
                 if (!flags2) return 1;
                 int i, j = 0;
                 for (i = 0; i < dp->alen; i++) {
@@ -324,7 +479,8 @@ int HashMgr::add_with_affix(const char * word, const char * example)
 	if (aliasf) {
 	    add_word(word, wbl, wcl, dp->astr, dp->alen, NULL, false);	
 	} else {
-    	    unsigned short * flags = (unsigned short *) malloc (dp->alen * sizeof(short));
+    	    unsigned short * flags =
+                (unsigned short *) arena_alloc(dp->alen * sizeof(short), sizeof(short));
 	    if (flags) {
 		memcpy((void *) flags, (void *) dp->astr, dp->alen * sizeof(short));
 		add_word(word, wbl, wcl, flags, dp->alen, NULL, false);
@@ -335,6 +491,11 @@ int HashMgr::add_with_affix(const char * word, const char * example)
     return 1;
 }
 
+int HashMgr::get_tablesize() const
+{
+  return tablesize;
+}
+
 // walk the hash table entry by entry - null at end
 // initialize: col=-1; hp = NULL; hp = walk_hashtable(&col, hp);
 struct hentry * HashMgr::walk_hashtable(int &col, struct hentry * hp) const
@@ -445,7 +606,7 @@ int HashMgr::load_tables(const char * tpath, const char * key)
             *ap = '\0';
         }
       } else {
-        al = decode_flags(&flags, ap + 1, dict);
+        al = decode_flags(&flags, ap + 1, dict, 1);
         if (al == -1) {
             HUNSPELL_WARNING(stderr, "Can't allocate memory.\n");
             delete dict;
@@ -474,6 +635,245 @@ int HashMgr::load_tables(const char * tpath, const char * key)
   return 0;
 }
 
+// load the hash table from the compiled dictionary, if it is up to date
+int HashMgr::load_compiled(const char * tpath, const char * apath, const char * cpath)
+{
+  struct compiled_header h;
+  long long dicsize, dicmtime, affsize, affmtime;
+  if (file_stamp(tpath, &dicsize, &dicmtime) || file_stamp(apath, &affsize, &affmtime))
+    return 1;
+
+  compiled = map_file(cpath, &compiledsize);
+  if (!compiled) return 1;
+  if (compiledsize < sizeof(h)) {
+    free_compiled();
+    return 1;
+  }
+  memcpy(&h, compiled, sizeof(h));
+  if (memcmp(h.magic, COMPILED_MAGIC, sizeof(h.magic)) != 0 ||
+      h.version != COMPILED_VERSION || h.ptrsize != (int) sizeof(void *) ||
+      h.entrysize != (int) sizeof(struct hentry) || h.tablesize <= 0 ||
+      h.numaliasf != numaliasf || h.numaliasm != numaliasm ||
+      h.dicsize != dicsize || h.dicmtime != dicmtime ||
+      h.affsize != affsize || h.affmtime != affmtime ||
+      h.filesize != (long long) compiledsize ||
+      h.tableoff != (long long) COMPILED_ALIGN(sizeof(h)) ||
+      h.entriesoff != h.tableoff + (long long) (h.tablesize * sizeof(struct hentry *)) ||
+      h.flagsoff < h.entriesoff || h.flagsoff > h.filesize) {
+    free_compiled();
+    return 1;
+  }
+
+  // replace the stored offsets with pointers into the mapping; records of a
+  // chain follow each other, so a valid link always points forward
+  size_t entriesend = (size_t) h.flagsoff;
+  struct hentry ** table = (struct hentry **) (compiled + h.tableoff);
+  int bad = 0;
+  for (int i = 0; i < h.tablesize && !bad; i++) {
+    size_t off = (size_t) table[i];
+    if (!off) continue;
+    if (off < (size_t) h.entriesoff || off + sizeof(struct hentry) > entriesend) {
+      bad = 1;
+      break;
+    }
+    table[i] = (struct hentry *) (compiled + off);
+    for (struct hentry * hp = table[i]; hp; hp = hp->next) {
+      size_t cur = (char *) hp - compiled;
+      off = (size_t) hp->next;
+      if (off && (off <= cur || off + sizeof(struct hentry) > entriesend)) { bad = 1; break; }
+      hp->next = off ? (struct hentry *) (compiled + off) : NULL;
+      off = (size_t) hp->next_homonym;
+      if (off && (off <= cur || off + sizeof(struct hentry) > entriesend)) { bad = 1; break; }
+      hp->next_homonym = off ? (struct hentry *) (compiled + off) : NULL;
+      off = (size_t) hp->astr;
+      if (off & 1) {
+        if ((off >> 1) >= (size_t) numaliasf) { bad = 1; break; }
+        hp->astr = aliasf[off >> 1];
+      } else if (off) {
+        if (off < (size_t) h.flagsoff ||
+            off + hp->alen * sizeof(unsigned short) > compiledsize) { bad = 1; break; }
+        hp->astr = (unsigned short *) (compiled + off);
+      }
+      if (hp->var & H_OPT_ALIASM) {
+        size_t k = (size_t) get_stored_pointer(HENTRY_WORD(hp) + hp->blen + 1);
+        if (k >= (size_t) numaliasm) { bad = 1; break; }
+        store_pointer(HENTRY_WORD(hp) + hp->blen + 1, aliasm[k]);
+      }
+    }
+  }
+  if (bad) {
+    HUNSPELL_WARNING(stderr, "warning: damaged compiled dictionary %s\n", cpath);
+    free_compiled();
+    return 1;
+  }
+  tableptr = table;
+  tablesize = h.tablesize;
+  return 0;
+}
+
+// store the hash table in compiled form to skip parsing of the dic file on the
+// next load: the records are written chain by chain, the pointers are replaced
+// with file offsets, alias vectors with their (odd-marked) indexes
+int HashMgr::save_compiled(const char * tpath, const char * apath, const char * cpath)
+{
+  struct compiled_header h;
+  memset(&h, 0, sizeof(h));
+  if (file_stamp(tpath, &h.dicsize, &h.dicmtime) || file_stamp(apath, &h.affsize, &h.affmtime))
+    return 1;
+  memcpy(h.magic, COMPILED_MAGIC, sizeof(h.magic));
+  h.version = COMPILED_VERSION;
+  h.ptrsize = sizeof(void *);
+  h.entrysize = sizeof(struct hentry);
+  h.tablesize = tablesize;
+  h.numaliasf = numaliasf;
+  h.numaliasm = numaliasm;
+
+  struct ptr_index * fidx = make_ptr_index((void **) aliasf, numaliasf);
+  struct ptr_index * midx = make_ptr_index((void **) aliasm, numaliasm);
+  if ((numaliasf && !fidx) || (numaliasm && !midx)) {
+    if (fidx) free(fidx);
+    if (midx) free(midx);
+    return 1;
+  }
+
+  size_t entries = 0;
+  size_t flags = 0;
+  for (int i = 0; i < tablesize; i++) {
+    for (struct hentry * hp = tableptr[i]; hp; hp = hp->next) {
+      entries += compiled_entry_size(hp);
+      if (hp->astr && find_ptr_index(fidx, numaliasf, hp->astr) < 0)
+        flags += hp->alen * sizeof(unsigned short);
+    }
+  }
+  h.tableoff = COMPILED_ALIGN(sizeof(h));
+  h.entriesoff = h.tableoff + tablesize * sizeof(struct hentry *);
+  h.flagsoff = h.entriesoff + entries;
+  h.filesize = h.flagsoff + flags;
+
+  char * buf = (char *) calloc(1, (size_t) h.filesize);
+  if (!buf) {
+    if (fidx) free(fidx);
+    if (midx) free(midx);
+    return 1;
+  }
+  memcpy(buf, &h, sizeof(h));
+  struct hentry ** table = (struct hentry **) (buf + h.tableoff);
+  size_t eoff = (size_t) h.entriesoff;
+  size_t foff = (size_t) h.flagsoff;
+  int bad = 0;
+  for (int i = 0; i < tablesize && !bad; i++) {
+    if (tableptr[i]) table[i] = (struct hentry *) eoff;
+    for (struct hentry * hp = tableptr[i]; hp; hp = hp->next) {
+      size_t size = compiled_entry_size(hp);
+      struct hentry * rec = (struct hentry *) (buf + eoff);
+      rec->blen = hp->blen;
+      rec->clen = hp->clen;
+      rec->alen = hp->alen;
+      rec->var = hp->var;
+      strcpy(HENTRY_WORD(rec), HENTRY_WORD(hp));
+      if (hp->var & H_OPT_ALIASM) {
+        int k = find_ptr_index(midx, numaliasm, get_stored_pointer(HENTRY_WORD(hp) + hp->blen + 1));
+        if (k < 0) { bad = 1; break; }
+        store_pointer(HENTRY_WORD(rec) + hp->blen + 1, (char *) (size_t) k);
+      } else if (hp->var & H_OPT) {
+        strcpy(HENTRY_WORD(rec) + hp->blen + 1, HENTRY_DATA(hp));
+      }
+      if (hp->astr) {
+        int k = find_ptr_index(fidx, numaliasf, hp->astr);
+        if (k >= 0) {
+          rec->astr = (unsigned short *) ((((size_t) k) << 1) | 1);
+        } else {
+          memcpy(buf + foff, hp->astr, hp->alen * sizeof(unsigned short));
+          rec->astr = (unsigned short *) foff;
+          foff += hp->alen * sizeof(unsigned short);
+        }
+      }
+      if (hp->next) rec->next = (struct hentry *) (eoff + size);
+      if (hp->next_homonym) {
+        // homonyms are always linked later into the same chain
+        size_t off = eoff + size;
+        struct hentry * dp = hp->next;
+        for (; dp && dp != hp->next_homonym; dp = dp->next) off += compiled_entry_size(dp);
+        if (!dp) { bad = 1; break; }
+        rec->next_homonym = (struct hentry *) off;
+      }
+      eoff += size;
+    }
+  }
+  if (fidx) free(fidx);
+  if (midx) free(midx);
+  if (bad) {
+    free(buf);
+    return 1;
+  }
+
+  // write into a temporary file first, so a concurrent load never sees
+  // a partially written dictionary
+  char * tmp = (char *) malloc(strlen(cpath) + 5);
+  if (!tmp) {
+    free(buf);
+    return 1;
+  }
+  strcpy(tmp, cpath);
+  strcat(tmp, ".tmp");
+  FILE * f = fopen(tmp, "wb");
+  int ec = 1;
+  if (f) {
+    ec = fwrite(buf, 1, (size_t) h.filesize, f) != (size_t) h.filesize;
+    if (fclose(f) != 0) ec = 1;
+#ifdef _WIN32
+    if (!ec) ::remove(cpath);
+#endif
+    if (!ec) ec = rename(tmp, cpath) != 0;
+    if (ec) ::remove(tmp);
+  }
+  free(tmp);
+  free(buf);
+  return ec;
+}
+
+void HashMgr::free_compiled()
+{
+  if (compiled) unmap_file(compiled, compiledsize);
+  compiled = NULL;
+  compiledsize = 0;
+}
+
+int HashMgr::is_compiled(const void * p) const
+{
+  return compiled && (const char *) p >= compiled && (const char *) p < compiled + compiledsize;
+}
+
+// bump allocation from the current block, a new (bigger) block is started
+// when the request does not fit into the rest of the current one
+void * HashMgr::arena_alloc(size_t size, size_t align)
+{
+  size_t used = arena ? (arena->used + align - 1) & ~(align - 1) : 0;
+  if (!arena || used + size > arena->size) {
+    size_t bsize = arena ? arena->size * 2 : ARENA_BLOCK_MIN;
+    if (bsize > ARENA_BLOCK_MAX) bsize = ARENA_BLOCK_MAX;
+    if (bsize < size) bsize = size;
+    struct arena_block * block = (struct arena_block *) malloc(ARENA_HEADER + bsize);
+    if (!block) return NULL;
+    block->next = arena;
+    block->size = bsize;
+    block->used = 0;
+    arena = block;
+    used = 0;
+  }
+  arena->used = used + size;
+  return (char *) arena + ARENA_HEADER + used;
+}
+
+void HashMgr::free_arena()
+{
+  while (arena) {
+    struct arena_block * next = arena->next;
+    free(arena);
+    arena = next;
+  }
+}
+
 // the hash function is a simple load and rotate
 // algorithm borrowed
 
@@ -489,7 +889,8 @@ int HashMgr::hash(const char * word) const
     return (unsigned long) hv % tablesize;
 }
 
-int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af) {
+// inarena: allocate the flag vector from the arena of the word records
+int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af, int inarena) {
     int len;
     if (*flags == '\0') {
         *result = NULL;
@@ -500,7 +901,8 @@ int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af)
         len = strlen(flags);
         if (len%2 == 1) HUNSPELL_WARNING(stderr, "error: line %d: bad flagvector\n", af->getlinenum());
         len /= 2;
-        *result = (unsigned short *) malloc(len * sizeof(short));
+        *result = (unsigned short *) (inarena ? arena_alloc(len * sizeof(short), sizeof(short)) :
+            malloc(len * sizeof(short)));
         if (!*result) return -1;
         for (int i = 0; i < len; i++) {
             (*result)[i] = (((unsigned short) flags[i * 2]) << 8) + (unsigned short) flags[i * 2 + 1]; 
@@ -516,7 +918,8 @@ int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af)
         for (p = flags; *p; p++) {
           if (*p == ',') len++;
         }
-        *result = (unsigned short *) malloc(len * sizeof(short));
+        *result = (unsigned short *) (inarena ? arena_alloc(len * sizeof(short), sizeof(short)) :
+            malloc(len * sizeof(short)));
         if (!*result) return -1;
         dest = *result;
         for (p = flags; *p; p++) {
@@ -540,7 +943,8 @@ int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af)
       case FLAG_UNI: { // UTF-8 characters
         w_char w[BUFSIZE/2];
         len = u8_u16(w, BUFSIZE/2, flags);
-        *result = (unsigned short *) malloc(len * sizeof(short));
+        *result = (unsigned short *) (inarena ? arena_alloc(len * sizeof(short), sizeof(short)) :
+            malloc(len * sizeof(short)));
         if (!*result) return -1;
         memcpy(*result, w, len * sizeof(short));
         break;
@@ -548,7 +952,8 @@ int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af)
       default: { // Ispell's one-character flags (erfg -> e r f g)
         unsigned short * dest;
         len = strlen(flags);
-        *result = (unsigned short *) malloc(len * sizeof(short));
+        *result = (unsigned short *) (inarena ? arena_alloc(len * sizeof(short), sizeof(short)) :
+            malloc(len * sizeof(short)));
         if (!*result) return -1;
         dest = *result;
         for (unsigned char * p = (unsigned char *) flags; *p; p++) {
@@ -10,6 +10,8 @@
 
 enum flag { FLAG_CHAR, FLAG_LONG, FLAG_NUM, FLAG_UNI };
 
+struct arena_block;
+
 class LIBHUNSPELL_DLL_EXPORTED HashMgr
 {
   int               tablesize;
@@ -31,6 +33,9 @@ class LIBHUNSPELL_DLL_EXPORTED HashMgr
   unsigned short *  aliasflen;
   int               numaliasm; // morphological desciption `compression' with aliases
   char **           aliasm;
+  char *            compiled;     // mapped compiled dictionary (see load_compiled)
+  size_t            compiledsize;
+  struct arena_block * arena;     // word records and their flag vectors (see arena_alloc)
 
 
 public:
@@ -39,12 +44,13 @@ public:
 
   struct hentry * lookup(const char *) const;
   int hash(const char *) const;
+  int get_tablesize() const;
   struct hentry * walk_hashtable(int & col, struct hentry * hp) const;
 
   int add(const char * word);
   int add_with_affix(const char * word, const char * pattern);
   int remove(const char * word);
-  int decode_flags(unsigned short ** result, char * flags, FileMgr * af);
+  int decode_flags(unsigned short ** result, char * flags, FileMgr * af, int inarena = 0);
   unsigned short        decode_flag(const char * flag);
   char *                encode_flag(unsigned short flag);
   int is_aliasf();
@@ -63,6 +69,12 @@ private:
     unsigned short * flags, int al, char * dp, int captype);
   int parse_aliasm(char * line, FileMgr * af);
   int remove_forbidden_flag(const char * word);
+  int load_compiled(const char * tpath, const char * apath, const char * cpath);
+  int save_compiled(const char * tpath, const char * apath, const char * cpath);
+  void free_compiled();
+  int is_compiled(const void * p) const;
+  void * arena_alloc(size_t size, size_t align);
+  void free_arena();
 
 };
 
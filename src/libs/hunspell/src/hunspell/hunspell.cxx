@@ -43,10 +43,15 @@ Hunspell::Hunspell(const char * affpath, const char * dpath, const char * key)
     /* and finally set up the suggestion manager */
     pSMgr = new SuggestMgr(try_string, MAXSUGGESTION, pAMgr);
     if (try_string) free(try_string);
+
+    spellcache = new SpellCache(SPELLCACHE_SIZE);
+    dicversion = 0;
 }
 
 Hunspell::~Hunspell()
 {
+    if (spellcache) delete spellcache;
+    spellcache = NULL;
     if (pSMgr) delete pSMgr;
     if (pAMgr) delete pAMgr;
     for (int i = 0; i < maxdic; i++) delete pHMgr[i];
@@ -68,6 +73,7 @@ int Hunspell::add_dic(const char * dpath, const char * key) {
     if (maxdic == MAXDIC || !affixpath) return 1;
     pHMgr[maxdic] = new HashMgr(dpath, affixpath, key);
     if (pHMgr[maxdic]) maxdic++; else return 1;
+    dicversion++;
     return 0;
 }
 
@@ -320,7 +326,33 @@ int Hunspell::insert_sug(char ***slst, char * word, int ns) {
     return ns + 1;
 }
 
+void Hunspell::set_spell_cache_size(int n)
+{
+  if (spellcache) delete spellcache;
+  spellcache = (n > 0) ? new SpellCache(n) : NULL;
+}
+
+void Hunspell::get_spell_cache_stats(long * hits, long * misses)
+{
+  if (hits) *hits = spellcache ? spellcache->get_hits() : 0;
+  if (misses) *misses = spellcache ? spellcache->get_misses() : 0;
+}
+
 int Hunspell::spell(const char * word, int * info, char ** root)
+{
+  // the cache stores the result with the info bits, but not the root
+  if (!spellcache || root) return spell_word(word, info, root);
+  int cinfo = 0;
+  int ret = spellcache->lookup(word, dicversion, &cinfo);
+  if (ret < 0) {
+    ret = spell_word(word, &cinfo, NULL);
+    spellcache->add(word, dicversion, ret, cinfo);
+  }
+  if (info) *info = cinfo;
+  return ret;
+}
+
+int Hunspell::spell_word(const char * word, int * info, char ** root)
 {
   struct hentry * rv=NULL;
   // need larger vector. For example, Turkish capital letter I converted a
@@ -673,7 +705,24 @@ struct hentry * Hunspell::checkword(const char * w, int * info, char ** root)
   return he;
 }
 
+void Hunspell::set_suggest_timelimit(int msec)
+{
+  if (pSMgr) pSMgr->set_timelimit(msec);
+}
+
+void Hunspell::set_suggest_threads(int n)
+{
+  if (pSMgr) pSMgr->set_threads(n);
+}
+
 int Hunspell::suggest(char*** slst, const char * word)
+{
+  // the nested searches of suggest_word() share the time limit
+  if (pSMgr) pSMgr->start_timer();
+  return suggest_word(slst, word);
+}
+
+int Hunspell::suggest_word(char*** slst, const char * word)
 {
   int onlycmpdsug = 0;
   char cw[MAXWORDUTF8LEN];
@@ -906,7 +955,7 @@ int Hunspell::suggest(char*** slst, const char * word)
      while (nodashsug && !last) {
 	if (*pos == '\0') last = 1; else *pos = '\0';
         if (!spell(ppos)) {
-          nn = suggest(&nlst, ppos);
+          nn = suggest_word(&nlst, ppos);
           for (int j = nn - 1; j >= 0; j--) {
             strncpy(wspace, cw, ppos - cw);
             strcpy(wspace + (ppos - cw), nlst[j]);
@@ -1326,18 +1375,21 @@ int Hunspell::mkinitsmall2(char * p, w_char * u, int nc)
 
 int Hunspell::add(const char * word)
 {
+    dicversion++;
     if (pHMgr[0]) return (pHMgr[0])->add(word);
     return 0;
 }
 
 int Hunspell::add_with_affix(const char * word, const char * example)
 {
+    dicversion++;
     if (pHMgr[0]) return (pHMgr[0])->add_with_affix(word, example);
     return 0;
 }
 
 int Hunspell::remove(const char * word)
 {
+    dicversion++;
     if (pHMgr[0]) return (pHMgr[0])->remove(word);
     return 0;
 }
@@ -3,6 +3,7 @@
 #include "hashmgr.hxx"
 #include "affixmgr.hxx"
 #include "suggestmgr.hxx"
+#include "spellcache.hxx"
 #include "langnum.hxx"
 
 #define  SPELL_XML "<?xml?>"
@@ -30,6 +31,8 @@ class LIBHUNSPELL_DLL_EXPORTED Hunspell
   int             utf8;
   int             complexprefixes;
   char**          wordbreak;
+  SpellCache*     spellcache;
+  int             dicversion; // changed by the run-time modification of the dictionary
 
 public:
 
@@ -55,6 +58,15 @@ public:
    
   int spell(const char * word, int * info = NULL, char ** root = NULL);
 
+  /* spell check result cache (the results of the recently checked words
+   * are returned without the dictionary lookup, calls with root bypass it):
+   * set_spell_cache_size(n) - cache the results of n words (0: no cache)
+   * get_spell_cache_stats(hits, misses) - cache statistics since the setup
+   */
+
+  void set_spell_cache_size(int n);
+  void get_spell_cache_stats(long * hits, long * misses);
+
   /* suggest(suggestions, word) - search suggestions
    * input: pointer to an array of strings pointer and the (bad) word
    *   array of strings pointer (here *slst) may not be initialized
@@ -65,6 +77,16 @@ public:
 
   int suggest(char*** slst, const char * word);
 
+  /* suggestion search settings for interactive use:
+   * set_suggest_timelimit(msec) - return the suggestions found until
+   *   the time limit (0: no limit, default)
+   * set_suggest_threads(n) - scan the dictionaries for similar words with
+   *   n threads (1: no threads, default; 0: one thread per processor core)
+   */
+
+  void set_suggest_timelimit(int msec);
+  void set_suggest_threads(int n);
+
   /* deallocate suggestion lists */
 
   void free_list(char *** slst, int n);
@@ -159,6 +181,8 @@ private:
    hentry * spellsharps(char * base, char *, int, int, char * tmp, int * info, char **root);
    int    is_keepcase(const hentry * rv);
    int    insert_sug(char ***slst, char * word, int ns);
+   int    suggest_word(char*** slst, const char * word);
+   int    spell_word(const char * word, int * info, char ** root);
    void   cat_result(char * result, char * st);
    char * stem_description(const char * desc);
    int    spellml(char*** slst, const char * word);
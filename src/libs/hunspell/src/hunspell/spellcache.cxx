@@ -0,0 +1,123 @@
+#include "license.hunspell"
+#include "license.myspell"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "spellcache.hxx"
+
+SpellCache::SpellCache(int n) {
+    dat = (struct spellcache_entry *) malloc(sizeof(struct spellcache_entry) * n);
+    buckets = (int *) malloc(sizeof(int) * n);
+    if (dat == 0 || buckets == 0) {
+        if (dat) free(dat);
+        if (buckets) free(buckets);
+        dat = 0;
+        buckets = 0;
+        size = 0;
+    } else size = n;
+    for (int i = 0; i < size; i++) buckets[i] = -1;
+    pos = 0;
+    head = -1;
+    tail = -1;
+    hits = 0;
+    misses = 0;
+}
+
+SpellCache::~SpellCache()
+{
+    if (dat) free(dat);
+    if (buckets) free(buckets);
+}
+
+// result of the word checked with the same dictionary version, or -1
+int SpellCache::lookup(const char * word, int version, int * info) {
+    if (size == 0 || strlen(word) >= SPELLCACHE_MAXWORD) return -1;
+    int i = find(word, hash(word));
+    if (i < 0 || dat[i].version != version) {
+        misses++;
+        return -1;
+    }
+    hits++;
+    unlink(i);
+    push_front(i);
+    if (info) *info = dat[i].info;
+    return dat[i].result;
+}
+
+// store the result, the least recently used entry is replaced in a full cache
+void SpellCache::add(const char * word, int version, int result, int info) {
+    if (size == 0 || strlen(word) >= SPELLCACHE_MAXWORD) return;
+    unsigned int h = hash(word);
+    int i = find(word, h);
+    if (i >= 0) {
+        unlink(i);
+    } else {
+        if (pos < size) {
+            i = pos++;
+        } else {
+            i = tail;
+            unlink(i);
+            unlink_bucket(i, hash(dat[i].word));
+        }
+        strcpy(dat[i].word, word);
+        dat[i].hnext = buckets[h];
+        buckets[h] = i;
+    }
+    dat[i].version = version;
+    dat[i].result = result;
+    dat[i].info = info;
+    push_front(i);
+}
+
+long SpellCache::get_hits() {
+    return hits;
+}
+
+long SpellCache::get_misses() {
+    return misses;
+}
+
+// FNV-1a
+unsigned int SpellCache::hash(const char * word) {
+    unsigned int h = 2166136261u;
+    for (; *word; word++) {
+        h ^= (unsigned char) *word;
+        h *= 16777619u;
+    }
+    return h % size;
+}
+
+int SpellCache::find(const char * word, unsigned int h) {
+    for (int i = buckets[h]; i >= 0; i = dat[i].hnext) {
+        if (strcmp(dat[i].word, word) == 0) return i;
+    }
+    return -1;
+}
+
+void SpellCache::unlink(int i) {
+    if (dat[i].prev >= 0) dat[dat[i].prev].next = dat[i].next; else head = dat[i].next;
+    if (dat[i].next >= 0) dat[dat[i].next].prev = dat[i].prev; else tail = dat[i].prev;
+}
+
+void SpellCache::push_front(int i) {
+    dat[i].prev = -1;
+    dat[i].next = head;
+    if (head >= 0) dat[head].prev = i;
+    head = i;
+    if (tail < 0) tail = i;
+}
+
+void SpellCache::unlink_bucket(int i, unsigned int h) {
+    if (buckets[h] == i) {
+        buckets[h] = dat[i].hnext;
+        return;
+    }
+    for (int j = buckets[h]; j >= 0; j = dat[j].hnext) {
+        if (dat[j].hnext == i) {
+            dat[j].hnext = dat[i].hnext;
+            return;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/* LRU cache of spell check results */
+#ifndef _SPELLCACHE_HXX_
+#define _SPELLCACHE_HXX_
+
+#include "hunvisapi.h"
+
+#define SPELLCACHE_SIZE 4096
+#define SPELLCACHE_MAXWORD 48 // longer words are checked without the cache
+
+struct spellcache_entry {
+    char word[SPELLCACHE_MAXWORD];
+    int version;   // dictionary version of the result
+    int result;
+    int info;
+    int hnext;     // next entry of the hash bucket (-1: end)
+    int prev;      // LRU list, most recently used first (-1: end)
+    int next;
+};
+
+class LIBHUNSPELL_DLL_EXPORTED SpellCache
+{
+protected:
+    struct spellcache_entry * dat;
+    int * buckets;
+    int size;
+    int pos;
+    int head;
+    int tail;
+    long hits;
+    long misses;
+
+public:
+    SpellCache(int n);
+    ~SpellCache();
+
+    int lookup(const char * word, int version, int * info);
+    void add(const char * word, int version, int result, int info);
+    long get_hits();
+    long get_misses();
+
+private:
+    unsigned int hash(const char * word);
+    int find(const char * word, unsigned int h);
+    void unlink(int i);
+    void push_front(int i);
+    void unlink_bucket(int i, unsigned int h);
+};
+#endif
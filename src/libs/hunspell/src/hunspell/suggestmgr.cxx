@@ -6,12 +6,106 @@
 #include <stdio.h> 
 #include <ctype.h>
 
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include <thread>
+#include <vector>
+
 #include "suggestmgr.hxx"
 #include "htypes.hxx"
 #include "csutil.hxx"
 
 const w_char W_VLINE = { '\0', '|' };
 
+// monotonic wall clock time: clock() counts the process time of all threads
+static long long now_msec()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void ngroots_init(struct ngroots * r)
+{
+  for (int i = 0; i < MAX_ROOTS; i++) {
+    r->roots[i] = NULL;
+    r->scores[i] = -100 * i;
+    r->rootsphon[i] = NULL;
+    r->scoresphon[i] = -100 * i;
+    r->orders[i] = -1;
+    r->ordersphon[i] = -1;
+  }
+  r->lp = MAX_ROOTS - 1;
+  r->lpphon = MAX_ROOTS - 1;
+}
+
+// keep the root word in place of the worst one, if its score is better
+static void ngroots_add(struct ngroots * r, struct hentry * hp, int sc, long long order)
+{
+  if (sc > r->scores[r->lp]) {
+    r->scores[r->lp] = sc;
+    r->roots[r->lp] = hp;
+    r->orders[r->lp] = order;
+    int lval = sc;
+    for (int j = 0; j < MAX_ROOTS; j++)
+      if (r->scores[j] < lval) {
+        r->lp = j;
+        lval = r->scores[j];
+      }
+  }
+}
+
+static void ngroots_addphon(struct ngroots * r, char * word, int scphon, long long order)
+{
+  if (scphon > r->scoresphon[r->lpphon]) {
+    r->scoresphon[r->lpphon] = scphon;
+    r->rootsphon[r->lpphon] = word;
+    r->ordersphon[r->lpphon] = order;
+    int lval = scphon;
+    for (int j = 0; j < MAX_ROOTS; j++)
+      if (r->scoresphon[j] < lval) {
+        r->lpphon = j;
+        lval = r->scoresphon[j];
+      }
+  }
+}
+
+// a root word kept by a part of the scan, for the merge of the parts
+struct ngcandidate {
+  long long order;
+  struct hentry * hp;
+  char * word;
+  int sc;
+};
+
+static bool ngcandidate_before(const ngcandidate & a, const ngcandidate & b)
+{
+  return a.order < b.order;
+}
+
+// merge the best root words of the parts: adding them in the order of the
+// sequential scan breaks the ties between equal scores the same way
+static void ngroots_merge(struct ngroots * r, const std::vector<struct ngroots> & parts)
+{
+  std::vector<ngcandidate> roots, rootsphon;
+  for (size_t i = 0; i < parts.size(); i++) {
+    for (int j = 0; j < MAX_ROOTS; j++) {
+      if (parts[i].roots[j]) {
+        ngcandidate c = { parts[i].orders[j], parts[i].roots[j], NULL, parts[i].scores[j] };
+        roots.push_back(c);
+      }
+      if (parts[i].rootsphon[j]) {
+        ngcandidate c = { parts[i].ordersphon[j], NULL, parts[i].rootsphon[j], parts[i].scoresphon[j] };
+        rootsphon.push_back(c);
+      }
+    }
+  }
+  std::sort(roots.begin(), roots.end(), ngcandidate_before);
+  std::sort(rootsphon.begin(), rootsphon.end(), ngcandidate_before);
+  for (size_t i = 0; i < roots.size(); i++) ngroots_add(r, roots[i].hp, roots[i].sc, roots[i].order);
+  for (size_t i = 0; i < rootsphon.size(); i++) ngroots_addphon(r, rootsphon[i].word, rootsphon[i].sc, rootsphon[i].order);
+}
+
 SuggestMgr::SuggestMgr(const char * tryme, int maxn, 
                        AffixMgr * aptr)
 {
@@ -38,6 +132,9 @@ SuggestMgr::SuggestMgr(const char * tryme, int maxn,
   nosplitsugs = 0;
   maxngramsugs = MAXNGRAMSUGS;
   maxcpdsugs = MAXCOMPOUNDSUGS;
+  ngthreads = 1;
+  suglimit = 0;
+  deadline = 0;
 
   if (pAMgr) {
         langnum = pAMgr->get_langnum();
@@ -102,6 +199,32 @@ SuggestMgr::~SuggestMgr()
 #endif
 }
 
+// number of threads scanning the dictionaries in ngsuggest (1: no threads,
+// 0: one thread per processor core)
+void SuggestMgr::set_threads(int n)
+{
+  if (n <= 0) n = std::thread::hardware_concurrency();
+  ngthreads = (n > 0) ? n : 1;
+}
+
+// time limit of the suggestion search, the suggestions found until the
+// deadline are returned (0: no limit)
+void SuggestMgr::set_timelimit(int msec)
+{
+  suglimit = (msec > 0) ? msec : 0;
+}
+
+// start the time limit of a new suggestion search
+void SuggestMgr::start_timer()
+{
+  deadline = suglimit ? now_msec() + suglimit : 0;
+}
+
+int SuggestMgr::out_of_time() const
+{
+  return deadline && (now_msec() >= deadline);
+}
+
 int SuggestMgr::testsug(char** wlst, const char * candidate, int wl, int ns, int cpdsuggest,
    int * timer, clock_t * timelimit) {
       int cwrd = 1;
@@ -167,18 +290,18 @@ int SuggestMgr::suggest(char*** slst, const char * w, int nsug,
     if (cpdsuggest > 0) oldSug = nsug;
 
     // suggestions for an uppercase word (html -> HTML)
-    if ((nsug < maxSug) && (nsug > -1)) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time()) {
         nsug = (utf8) ? capchars_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     capchars(wlst, word, nsug, cpdsuggest);
     }
 
     // perhaps we made a typical fault of spelling
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
       nsug = replchars(wlst, word, nsug, cpdsuggest);
     }
 
     // perhaps we made chose the wrong char from a related set
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
       nsug = mapchars(wlst, word, nsug, cpdsuggest);
     }
 
@@ -186,56 +309,56 @@ int SuggestMgr::suggest(char*** slst, const char * w, int nsug,
     if ((cpdsuggest == 0) && (nsug > nsugorig)) nocompoundtwowords=1;
 
     // did we swap the order of chars by mistake
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? swapchar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     swapchar(wlst, word, nsug, cpdsuggest);
     }
 
     // did we swap the order of non adjacent chars by mistake
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? longswapchar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     longswapchar(wlst, word, nsug, cpdsuggest);
     }
 
     // did we just hit the wrong key in place of a good char (case and keyboard)
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? badcharkey_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     badcharkey(wlst, word, nsug, cpdsuggest);
     }
 
     // did we add a char that should not be there
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? extrachar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     extrachar(wlst, word, nsug, cpdsuggest);
     }
 
 
     // did we forgot a char
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? forgotchar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     forgotchar(wlst, word, nsug, cpdsuggest);
     }
 
     // did we move a char
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? movechar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     movechar(wlst, word, nsug, cpdsuggest);
     }
 
     // did we just hit the wrong key in place of a good char
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? badchar_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     badchar(wlst, word, nsug, cpdsuggest);
     }
 
     // did we double two characters
-    if ((nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if ((nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = (utf8) ? doubletwochars_utf(wlst, word_utf, wl, nsug, cpdsuggest) :
                     doubletwochars(wlst, word, nsug, cpdsuggest);
     }
 
     // perhaps we forgot to hit space and two words ran together
-    if (!nosplitsugs && (nsug < maxSug) && (nsug > -1) && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
+    if (!nosplitsugs && (nsug < maxSug) && (nsug > -1) && !out_of_time() && (!cpdsuggest || (nsug < oldSug + maxcpdsugs))) {
         nsug = twowords(wlst, word, nsug, cpdsuggest);
     }
 
@@ -1004,31 +1127,96 @@ int SuggestMgr::movechar_utf(char ** wlst, const w_char * word, int wl, int ns,
    return ns;   
 }
 
+// n-gram scan of the part of the hash tables for the most similar root
+// words (the parts can be scanned by concurrent threads)
+void SuggestMgr::ngroots_scan(struct ngroots * r, HashMgr** pHMgr, int md, int part, int parts,
+    const char * w, int n, int low, phonetable * ph, const char * t)
+{
+  // own copies: ngram() marks the end of the n-grams in its first argument
+  char word[MAXWORDUTF8LEN];
+  char target[MAXSWUTF8L];
+  char candidate[MAXSWUTF8L];
+  char f[MAXSWUTF8L];
+  strcpy(word, w);
+  if (ph) strcpy(target, t);
+
+  int sc, scphon;
+  int count = 0;
+  ngroots_init(r);
+
+  FLAG forbiddenword = pAMgr ? pAMgr->get_forbiddenword() : FLAG_NULL;
+  FLAG nosuggest = pAMgr ? pAMgr->get_nosuggest() : FLAG_NULL;
+  FLAG nongramsuggest = pAMgr ? pAMgr->get_nongramsuggest() : FLAG_NULL;
+  FLAG onlyincompound = pAMgr ? pAMgr->get_onlyincompound() : FLAG_NULL;
+
+  for (int i = 0; i < md; i++) {
+  int tablesize = (pHMgr[i])->get_tablesize();
+  int first = (int) ((long long) tablesize * part / parts);
+  int last = (int) ((long long) tablesize * (part + 1) / parts);
+  int col = first - 1;
+  struct hentry* hp = NULL;
+  while (0 != (hp = (pHMgr[i])->walk_hashtable(col, hp)) && col < last) {
+    // partial result after the deadline
+    if ((++count % NGRAM_SCAN_STEP) == 0 && out_of_time()) return;
+
+    // position in the sequential scan: dictionaries, then parts, then the part
+    long long order = ((long long) (i * parts + part) << 32) + count;
+
+    if ((hp->astr) && (pAMgr) && 
+       (TESTAFF(hp->astr, forbiddenword, hp->alen) ||
+          TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
+          TESTAFF(hp->astr, nosuggest, hp->alen) ||
+          TESTAFF(hp->astr, nongramsuggest, hp->alen) ||
+          TESTAFF(hp->astr, onlyincompound, hp->alen))) continue;
+
+    sc = ngram(3, word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + low) +
+	leftcommonsubstring(word, HENTRY_WORD(hp));
+
+    // check special pronounciation
+    if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
+	int sc2 = ngram(3, word, f, NGRAM_LONGER_WORSE + low) +
+		+ leftcommonsubstring(word, f);
+	if (sc2 > sc) sc = sc2;
+    }
+    
+    scphon = -20000;
+    if (ph && (sc > 2) && (abs(n - (int) hp->clen) <= 3)) {
+      char target2[MAXSWUTF8L];
+      if (utf8) {
+        w_char _w[MAXSWL];
+        int _wl = u8_u16(_w, MAXSWL, HENTRY_WORD(hp));
+        mkallcap_utf(_w, _wl, langnum);
+        u16_u8(candidate, MAXSWUTF8L, _w, _wl);
+      } else {
+        strcpy(candidate, HENTRY_WORD(hp));
+        mkallcap(candidate, csconv);
+      }
+      phonet(candidate, target2, -1, *ph);
+      scphon = 2 * ngram(3, target, target2, NGRAM_LONGER_WORSE);
+    }
+
+    ngroots_add(r, hp, sc, order);
+    ngroots_addphon(r, HENTRY_WORD(hp), scphon, order);
+  }}
+}
+
 // generate a set of suggestions for very poorly spelled words
 int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md)
 {
 
   int i, j;
   int lval;
-  int sc, scphon;
-  int lp, lpphon;
+  int sc;
+  int lp;
   int nonbmp = 0;
 
   // exhaustively search through all root words
   // keeping track of the MAX_ROOTS most similar root words
-  struct hentry * roots[MAX_ROOTS];
-  char * rootsphon[MAX_ROOTS];
-  int scores[MAX_ROOTS];
-  int scoresphon[MAX_ROOTS];
-  for (i = 0; i < MAX_ROOTS; i++) {
-    roots[i] = NULL;
-    scores[i] = -100 * i;
-    rootsphon[i] = NULL;
-    scoresphon[i] = -100 * i;
-  }
-  lp = MAX_ROOTS - 1;
-  lpphon = MAX_ROOTS - 1;
-  scphon = -20000;
+  struct ngroots best;
+  ngroots_init(&best);
+  struct hentry ** roots = best.roots;
+  char ** rootsphon = best.rootsphon;
+  int * scoresphon = best.scoresphon;
   int low = NGRAM_LOWERING;
   
   char w2[MAXWORDUTF8LEN];
@@ -1055,8 +1243,6 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     low = 0;
   }
 
-  struct hentry* hp = NULL;
-  int col = -1;
   phonetable * ph = (pAMgr) ? pAMgr->get_phonetable() : NULL;
   char target[MAXSWUTF8L];
   char candidate[MAXSWUTF8L];
@@ -1073,69 +1259,28 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     phonet(candidate, target, nc, *ph); // XXX phonet() is 8-bit (nc, not n)
   }
 
-  FLAG forbiddenword = pAMgr ? pAMgr->get_forbiddenword() : FLAG_NULL;
-  FLAG nosuggest = pAMgr ? pAMgr->get_nosuggest() : FLAG_NULL;
-  FLAG nongramsuggest = pAMgr ? pAMgr->get_nongramsuggest() : FLAG_NULL;
-  FLAG onlyincompound = pAMgr ? pAMgr->get_onlyincompound() : FLAG_NULL;
-
-  for (i = 0; i < md; i++) {  
-  while (0 != (hp = (pHMgr[i])->walk_hashtable(col, hp))) {
-    if ((hp->astr) && (pAMgr) && 
-       (TESTAFF(hp->astr, forbiddenword, hp->alen) ||
-          TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
-          TESTAFF(hp->astr, nosuggest, hp->alen) ||
-          TESTAFF(hp->astr, nongramsuggest, hp->alen) ||
-          TESTAFF(hp->astr, onlyincompound, hp->alen))) continue;
-
-    sc = ngram(3, word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + low) +
-	leftcommonsubstring(word, HENTRY_WORD(hp));
-
-    // check special pronounciation
-    if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
-	int sc2 = ngram(3, word, f, NGRAM_LONGER_WORSE + low) +
-		+ leftcommonsubstring(word, f);
-	if (sc2 > sc) sc = sc2;
-    }
-    
-    scphon = -20000;
-    if (ph && (sc > 2) && (abs(n - (int) hp->clen) <= 3)) {
-      char target2[MAXSWUTF8L];
-      if (utf8) {
-        w_char _w[MAXSWL];
-        int _wl = u8_u16(_w, MAXSWL, HENTRY_WORD(hp));
-        mkallcap_utf(_w, _wl, langnum);
-        u16_u8(candidate, MAXSWUTF8L, _w, _wl);
-      } else {
-        strcpy(candidate, HENTRY_WORD(hp));
-        mkallcap(candidate, csconv);
+  if (ngthreads < 2) {
+    ngroots_scan(&best, pHMgr, md, 0, 1, word, n, low, ph, target);
+  } else {
+    // every thread scans its part of the hash tables, then the best root
+    // words of the parts are merged in the order of the sequential scan
+    std::vector<struct ngroots> parts(ngthreads);
+    std::vector<std::thread> threads;
+    threads.reserve(ngthreads);
+    try {
+      for (i = 0; i < ngthreads; i++) {
+        threads.emplace_back(&SuggestMgr::ngroots_scan, this, &parts[i], pHMgr, md,
+          i, ngthreads, word, n, low, ph, target);
       }
-      phonet(candidate, target2, -1, *ph);
-      scphon = 2 * ngram(3, target, target2, NGRAM_LONGER_WORSE);
+    } catch (const std::system_error &) {
+      // no more threads: the parts without a thread are scanned here
     }
-
-    if (sc > scores[lp]) {
-      scores[lp] = sc;  
-      roots[lp] = hp;
-      lval = sc;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scores[j] < lval) {
-          lp = j;
-          lval = scores[j];
-        }
-    }
-
-
-    if (scphon > scoresphon[lpphon]) {
-      scoresphon[lpphon] = scphon;
-      rootsphon[lpphon] = HENTRY_WORD(hp);
-      lval = scphon;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scoresphon[j] < lval) {
-          lpphon = j;
-          lval = scoresphon[j];
-        }
+    for (i = (int) threads.size(); i < ngthreads; i++) {
+      ngroots_scan(&parts[i], pHMgr, md, i, ngthreads, word, n, low, ph, target);
     }
-  }}
+    for (i = 0; i < (int) threads.size(); i++) threads[i].join();
+    ngroots_merge(&best, parts);
+  }
 
   // find minimum threshold for a passable suggestion
   // mangle original word three differnt ways
@@ -1176,7 +1321,7 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     return ns;
   }
 
-  for (i = 0; i < MAX_ROOTS; i++) {
+  for (i = 0; i < MAX_ROOTS && !out_of_time(); i++) {
       if (roots[i]) {
         struct hentry * rp = roots[i];
         int nw = pAMgr->expand_rootword(glst, MAX_WORDS, HENTRY_WORD(rp), rp->blen,
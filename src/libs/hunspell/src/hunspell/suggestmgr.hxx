@@ -15,6 +15,9 @@
 #define MINTIMER 100
 #define MAXPLUSTIMER 100
 
+// check the suggestion deadline after every NGRAM_SCAN_STEP dictionary words
+#define NGRAM_SCAN_STEP 1024
+
 #define NGRAM_LONGER_WORSE  (1 << 0)
 #define NGRAM_ANY_MISMATCH  (1 << 1)
 #define NGRAM_LOWERING      (1 << 2)
@@ -30,6 +33,20 @@
 
 enum { LCS_UP, LCS_LEFT, LCS_UPLEFT };
 
+// the most similar root words found in (a part of) the dictionaries by ngsuggest,
+// with their positions in the sequential scan of the dictionaries
+struct ngroots
+{
+  struct hentry * roots[MAX_ROOTS];
+  char *          rootsphon[MAX_ROOTS];
+  int             scores[MAX_ROOTS];
+  int             scoresphon[MAX_ROOTS];
+  long long       orders[MAX_ROOTS];
+  long long       ordersphon[MAX_ROOTS];
+  int             lp;
+  int             lpphon;
+};
+
 class LIBHUNSPELL_DLL_EXPORTED SuggestMgr
 {
   char *          ckey;
@@ -49,12 +66,19 @@ class LIBHUNSPELL_DLL_EXPORTED SuggestMgr
   int             maxngramsugs;
   int             maxcpdsugs;
   int             complexprefixes;
+  int             ngthreads;  // threads of the n-gram dictionary scan
+  int             suglimit;   // time limit of a suggestion search in msec (0: unlimited)
+  long long       deadline;   // end of the current suggestion search (see start_timer)
 
 
 public:
   SuggestMgr(const char * tryme, int maxn, AffixMgr *aptr);
   ~SuggestMgr();
 
+  void set_threads(int n);
+  void set_timelimit(int msec);
+  void start_timer();
+
   int suggest(char*** slst, const char * word, int nsug, int * onlycmpdsug);
   int ngsuggest(char ** wlst, char * word, int ns, HashMgr** pHMgr, int md);
   int suggest_auto(char*** slst, const char * word, int nsug);
@@ -70,6 +94,9 @@ private:
      int * timer, clock_t * timelimit);
    int checkword(const char *, int, int, int *, clock_t *);
    int check_forbidden(const char *, int);
+   int out_of_time() const;
+   void ngroots_scan(struct ngroots * r, HashMgr** pHMgr, int md, int part, int parts,
+     const char * word, int n, int low, phonetable * ph, const char * target);
 
    int capchars(char **, const char *, int, int);
    int replchars(char**, const char *, int, int);
@@ -0,0 +1,349 @@
+#include "license.readme"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mythes.h"
+#include "mappedmythes.h"
+
+// map a whole file read only, returns NULL on error or for an empty file
+static char * map_file(const char * path, size_t * size)
+{
+	char * data = NULL;
+	*size = 0;
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+	LARGE_INTEGER fsize;
+	if (GetFileSizeEx(file, &fsize) && fsize.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping) {
+			data = (char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (data) *size = (size_t) fsize.QuadPart;
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void * p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			data = (char *) p;
+			*size = st.st_size;
+		}
+	}
+	close(fd);
+#endif
+	return data;
+}
+
+
+static void unmap_file(char * data, size_t size)
+{
+	if (!data) return;
+#ifdef _WIN32
+	(void) size;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+
+// next line of the mapped text starting at p, the length excludes the
+// line terminator, returns the start of the following line
+static const char * next_line(const char * p, const char * end, int * len)
+{
+	const char * e = (const char *) memchr(p, '\n', end - p);
+	const char * next = e ? e + 1 : end;
+	if (!e) e = end;
+	if ((e > p) && (*(e-1) == '\r')) e--;
+	*len = (int)(e - p);
+	return next;
+}
+
+
+// parse the decimal number of the mapped text without a terminating null
+static unsigned int parse_number(const char * p, int len)
+{
+	unsigned int n = 0;
+	int i = 0;
+	while ((i < len) && ((p[i] == ' ') || (p[i] == '\t'))) i++;
+	for (; (i < len) && (p[i] >= '0') && (p[i] <= '9'); i++) n = n * 10 + (p[i] - '0');
+	return n;
+}
+
+
+int MyThesResult::count() const
+{
+	return (int) meanings.size();
+}
+
+
+thview MyThesResult::definition(int meaning) const
+{
+	return meanings[meaning].defn;
+}
+
+
+int MyThesResult::synonymCount(int meaning) const
+{
+	return meanings[meaning].count;
+}
+
+
+thview MyThesResult::synonym(int meaning, int index) const
+{
+	return syns[meanings[meaning].first + index];
+}
+
+
+MappedMyThes::MappedMyThes(const char* idxpath, const char* datpath, int ncache)
+{
+	idxdata = NULL;
+	idxsize = 0;
+	datdata = NULL;
+	datsize = 0;
+	cachesize = ncache;
+	hits = 0;
+	misses = 0;
+
+	if (thInitialize(idxpath, datpath) != 1) {
+		fprintf(stderr,"Error - can't open %s or %s\n",idxpath, datpath);
+		fflush(stderr);
+		list.clear();
+		unmap_file(datdata, datsize);
+		datdata = NULL;
+		datsize = 0;
+	}
+}
+
+
+MappedMyThes::~MappedMyThes()
+{
+	cache.clear();
+	lru.clear();
+	list.clear();
+	unmap_file(idxdata, idxsize);
+	unmap_file(datdata, datsize);
+}
+
+
+int MappedMyThes::thInitialize(const char* idxpath, const char* datpath)
+{
+	// map the index file
+	idxdata = map_file(idxpath, &idxsize);
+	if (!idxdata) return 0;
+
+	const char * p = idxdata;
+	const char * end = idxdata + idxsize;
+	int len;
+
+	// parse in encoding and index size
+	const char * wrd = p;
+	p = next_line(p, end, &len);
+	encoding.assign(wrd, len);
+	wrd = p;
+	p = next_line(p, end, &len);
+	int idxsz = (int) parse_number(wrd, len);
+	list.reserve(idxsz);
+
+	// now parse the remaining lines of the index, the words stay in the mapping
+	while (p < end) {
+		wrd = p;
+		p = next_line(p, end, &len);
+		if (len == 0) break;
+		const char * sep = (const char *) memchr(wrd, '|', len);
+		if ((int) list.size() < idxsz && sep) {
+			idxentry e;
+			e.wrd = wrd;
+			e.len = (int)(sep - wrd);
+			e.offst = parse_number(sep + 1, (int)(wrd + len - sep - 1));
+			list.push_back(e);
+		}
+	}
+
+	// next map the data file
+	datdata = map_file(datpath, &datsize);
+	if (!datdata) return 0;
+
+	return 1;
+}
+
+
+// lookup text in index and return the meanings of the word, each having
+// a definition and a list of synonyms, the strings point into the mapped
+// data file or into the result itself
+//
+// note: the result is shared with the lookup cache and stays valid while
+// it is referenced, but not longer than the thesaurus
+
+MappedMyThes::result_ptr MappedMyThes::Lookup(const char * pText, int len)
+{
+	// handle the case of missing file or file related errors
+	if (!datdata) return result_ptr();
+
+	std::string key(pText, len);
+	if (cachesize > 0) {
+		std::unordered_map<std::string, cacheentry>::iterator it = cache.find(key);
+		if (it != cache.end()) {
+			hits++;
+			lru.splice(lru.begin(), lru, it->second.pos);
+			return it->second.result;
+		}
+		misses++;
+	}
+
+	// words not found are cached too, they are looked up as often as the others
+	result_ptr result;
+	int idx = binsearch(pText, len);
+	if (idx >= 0) result = parseEntry(list[idx].offst);
+
+	if (cachesize > 0) {
+		if ((int) cache.size() >= cachesize) {
+			cache.erase(lru.back());
+			lru.pop_back();
+		}
+		lru.push_front(key);
+		cacheentry e;
+		e.result = result;
+		e.pos = lru.begin();
+		cache[key] = e;
+	}
+	return result;
+}
+
+
+MappedMyThes::result_ptr MappedMyThes::parseEntry(unsigned int offset) const
+{
+	if (offset >= datsize) return result_ptr();
+
+	const char * p = datdata + offset;
+	const char * end = datdata + datsize;
+	int len;
+
+	// grab the count of the number of meanings
+	const char * buf = p;
+	p = next_line(p, end, &len);
+	const char * sep = (const char *) memchr(buf, '|', len);
+	if (!sep) return result_ptr();
+	int nmeanings = (int) parse_number(sep + 1, (int)(buf + len - sep - 1));
+
+	std::shared_ptr<MyThesResult> result = std::make_shared<MyThesResult>();
+	result->meanings.reserve(nmeanings);
+
+	// now parse each meaning to get defn, count and synonym lists
+	for (int j = 0; (j < nmeanings) && (p < end); j++) {
+		buf = p;
+		p = next_line(p, end, &len);
+		const char * lend = buf + len;
+
+		// store away the part of speech for later use
+		const char * d = buf;
+		thview pos;
+		pos.str = buf;
+		pos.len = 0;
+		sep = (const char *) memchr(d, '|', len);
+		if (sep) {
+			pos.len = (int)(sep - buf);
+			d = sep + 1;
+		}
+
+		// fill in the synonym list
+		thmeaning m;
+		m.first = (int) result->syns.size();
+		for (;;) {
+			thview syn;
+			syn.str = d;
+			sep = (const char *) memchr(d, '|', lend - d);
+			syn.len = (int)((sep ? sep : lend) - d);
+			result->syns.push_back(syn);
+			if (!sep) break;
+			d = sep + 1;
+		}
+		m.count = (int) result->syns.size() - m.first;
+
+		// add pos to first synonym to create the definition, it is put in
+		// the arena and pointed to after all the definitions are in place
+		const thview & first = result->syns[m.first];
+		if ((pos.len + first.len) < (MAX_WD_LEN - 1)) {
+			result->arena.append(pos.str, pos.len);
+			result->arena.push_back(' ');
+			result->arena.append(first.str, first.len);
+			m.defn.str = NULL;
+			m.defn.len = pos.len + 1 + first.len;
+		} else {
+			m.defn = first;
+		}
+		result->meanings.push_back(m);
+	}
+
+	const char * a = result->arena.data();
+	for (size_t i = 0; i < result->meanings.size(); i++) {
+		thview & defn = result->meanings[i].defn;
+		if (!defn.str) {
+			defn.str = a;
+			a += defn.len;
+		}
+	}
+
+	return result;
+}
+
+
+//  performs a binary search on the words of the mapped index
+//
+//  returns: -1 on not found
+//           index of wrd in the list[]
+
+int MappedMyThes::binsearch(const char * wrd, int len) const
+{
+	int lp = 0;
+	int up = (int) list.size() - 1;
+	while (lp <= up) {
+		int mp = (lp + up) >> 1;
+		const idxentry & e = list[mp];
+		int j = memcmp(wrd, e.wrd, (len < e.len) ? len : e.len);
+		if (j == 0) j = len - e.len;
+		if (j > 0) {
+			lp = mp + 1;
+		} else if (j < 0) {
+			up = mp - 1;
+		} else {
+			return mp;
+		}
+	}
+	return -1;
+}
+
+
+const char* MappedMyThes::get_th_encoding() const
+{
+	if (!encoding.empty()) return encoding.c_str();
+	return NULL;
+}
+
+
+long MappedMyThes::cacheHits() const
+{
+	return hits;
+}
+
+
+long MappedMyThes::cacheMisses() const
+{
+	return misses;
+}
@@ -0,0 +1,109 @@
+#ifndef MAPPEDMYTHES_H
+#define MAPPEDMYTHES_H
+
+#include "MyThesGlobal.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// number of recent lookups kept by default
+#define MYTHES_CACHE_SIZE 256
+
+
+// a string in the memory mapped data file or in the arena of a lookup result,
+// not null terminated
+struct thview {
+	const char* str;
+	int  len;
+};
+
+// a meaning: definition and the range of its synonyms in the result
+struct thmeaning {
+	thview  defn;
+	int  first;
+	int  count;
+};
+
+
+// meanings of a word, all the strings of the lookup share its storage
+class MYTHESSHARED_EXPORT MyThesResult
+{
+	friend class MappedMyThes;
+
+	std::vector<thmeaning> meanings;
+	std::vector<thview> syns;
+	std::string arena;          /* definitions made of the part of speech and the first synonym */
+
+public:
+	int count() const;
+	thview definition(int meaning) const;
+	int synonymCount(int meaning) const;
+	thview synonym(int meaning, int index) const;
+};
+
+
+// thesaurus working directly on the memory mapped idx and dat files: the
+// index is parsed once without copying the words, a lookup parses the entry
+// in place and returns views into the mapping (so results must not outlive
+// the thesaurus), the results of recent lookups are cached
+class MYTHESSHARED_EXPORT MappedMyThes
+{
+	typedef std::shared_ptr<const MyThesResult> result_ptr;
+	typedef std::list<std::string> lru_list;
+
+	struct idxentry {
+		const char* wrd;
+		int  len;
+		unsigned int offst;
+	};
+
+	struct cacheentry {
+		result_ptr result;
+		lru_list::iterator pos;
+	};
+
+	char*  idxdata;             /* mapped index file */
+	size_t  idxsize;
+	char*  datdata;             /* mapped data file */
+	size_t  datsize;
+	std::vector<idxentry> list; /* stores word list */
+	std::string  encoding;      /* stores text encoding */
+
+	int  cachesize;
+	lru_list  lru;              /* cached words, most recently used first */
+	std::unordered_map<std::string, cacheentry> cache;
+	long  hits;
+	long  misses;
+
+	// disallow copy-constructor and assignment-operator
+	MappedMyThes(const MappedMyThes &);
+	MappedMyThes & operator = (const MappedMyThes &);
+
+public:
+	MappedMyThes(const char* idxpath, const char* datpath, int ncache = MYTHES_CACHE_SIZE);
+	~MappedMyThes();
+
+	// lookup text in index and return its meanings, or null if the word is not found
+	result_ptr Lookup(const char * pText, int len);
+
+	const char* get_th_encoding() const;
+
+	// statistics of the lookup cache
+	long cacheHits() const;
+	long cacheMisses() const;
+
+private:
+	// map index and dat files and build the word list
+	int thInitialize(const char* idxpath, const char* datpath);
+
+	// parse the dat entry at the offset
+	result_ptr parseEntry(unsigned int offset) const;
+
+	// binary search of the word in the word list
+	int binsearch(const char* wrd, int len) const;
+};
+
+#endif // MAPPEDMYTHES_H
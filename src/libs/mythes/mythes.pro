@@ -6,6 +6,8 @@
 
 QT       -= gui
 
+CONFIG += c++11
+
 mac:CONFIG += staticlib
 
 QMAKE_MAC_SDK = macosx10.12
@@ -30,10 +32,12 @@ RCC_DIR = $$DESTDIR/.qrc
 UI_DIR = $$DESTDIR/.ui
 #
 
-SOURCES += mythes.cpp
+SOURCES += mythes.cpp \
+    mappedmythes.cpp
 
 HEADERS += mythes.h \
-    MyThesGlobal.h
+    MyThesGlobal.h \
+    mappedmythes.h
 
 DISTFILES += \
     license.readme
@@ -17,8 +17,9 @@
 
 #include "HttpMultiPart.h"
 #include "QMimeDatabase"
+#include <QtCore/QFileInfo>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QStringList>
-#include <QtCore/QFile>
 
 
 HttpPart::HttpPart(HttpPartType _type) :
@@ -96,6 +97,114 @@ void HttpPart::setFilePath(const QString& _filePath)
 
 
 
+HttpMultiPartDevice::HttpMultiPartDevice(QObject* _parent) :
+	QIODevice(_parent)
+{
+}
+
+void HttpMultiPartDevice::appendData(const QByteArray& _data)
+{
+	if (_data.isEmpty()) {
+		return;
+	}
+
+	Segment segment;
+	segment.data = _data;
+	segment.offset = m_size;
+	segment.size = _data.size();
+	m_segments.append(segment);
+	m_size += segment.size;
+}
+
+void HttpMultiPartDevice::appendFile(const QString& _filePath)
+{
+	Segment segment;
+	segment.filePath = _filePath;
+	segment.offset = m_size;
+	segment.size = QFileInfo(_filePath).size();
+	if (segment.size == 0) {
+		return;
+	}
+
+	m_segments.append(segment);
+	m_size += segment.size;
+}
+
+qint64 HttpMultiPartDevice::size() const
+{
+	return m_size;
+}
+
+bool HttpMultiPartDevice::isSequential() const
+{
+	return false;
+}
+
+bool HttpMultiPartDevice::seek(qint64 _position)
+{
+	if (_position < 0 || _position > m_size) {
+		return false;
+	}
+
+	m_position = _position;
+	return QIODevice::seek(_position);
+}
+
+qint64 HttpMultiPartDevice::readData(char* _data, qint64 _maxSize)
+{
+	qint64 readed = 0;
+	for (int segmentIndex = 0; segmentIndex < m_segments.size() && readed < _maxSize; ++segmentIndex) {
+		const Segment& segment = m_segments.at(segmentIndex);
+		if (m_position >= segment.offset + segment.size) {
+			continue;
+		}
+
+		const qint64 segmentPosition = m_position - segment.offset;
+		const qint64 toRead = qMin(_maxSize - readed, segment.size - segmentPosition);
+		qint64 segmentReaded = 0;
+		if (segment.filePath.isEmpty()) {
+			memcpy(_data + readed, segment.data.constData() + segmentPosition, toRead);
+			segmentReaded = toRead;
+		} else {
+			//
+			// Файл открываем только на время чтения его фрагмента
+			//
+			if (m_fileSegment != segmentIndex) {
+				m_file.close();
+				m_file.setFileName(segment.filePath);
+				if (!m_file.open(QIODevice::ReadOnly)) {
+					m_fileSegment = -1;
+					return readed > 0 ? readed : -1;
+				}
+				m_fileSegment = segmentIndex;
+			}
+			if (m_file.pos() != segmentPosition) {
+				m_file.seek(segmentPosition);
+			}
+			segmentReaded = m_file.read(_data + readed, toRead);
+			if (segmentReaded <= 0) {
+				return readed > 0 ? readed : -1;
+			}
+		}
+
+		readed += segmentReaded;
+		m_position += segmentReaded;
+	}
+
+	return readed;
+}
+
+qint64 HttpMultiPartDevice::writeData(const char* _data, qint64 _maxSize)
+{
+	Q_UNUSED(_data);
+	Q_UNUSED(_maxSize);
+	return -1;
+}
+
+
+
+
+
 HttpMultiPart::HttpMultiPart()
 {
 }
@@ -114,33 +223,43 @@ void HttpMultiPart::addPart(const HttpPart& _part)
 
 QByteArray HttpMultiPart::data()
 {
-	QByteArray multiPartData;
-	foreach ( HttpPart httpPart, parts() ) {
-		QByteArray partData = makeDataFromPart( httpPart );
-		multiPartData.append( partData );
+	QScopedPointer<QIODevice> multiPartDevice(device());
+	return multiPartDevice->readAll();
+}
+
+qint64 HttpMultiPart::size()
+{
+	QScopedPointer<QIODevice> multiPartDevice(device());
+	return multiPartDevice->size();
+}
+
+QIODevice* HttpMultiPart::device()
+{
+	HttpMultiPartDevice* multiPartDevice = new HttpMultiPartDevice;
+	foreach (const HttpPart& httpPart, parts()) {
+		appendPart(multiPartDevice, httpPart);
 	}
 	// Добавление отметки о завершении данных
-	{
-		QByteArray endData = makeEndData();
-		multiPartData.append( endData );
-	}
-	return multiPartData;
+	multiPartDevice->appendData(makeEndData());
+	// Без буфера QIODevice позиция чтения в readData совпадает с pos() и seek()
+	multiPartDevice->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+	return multiPartDevice;
 }
 
-QByteArray HttpMultiPart::makeDataFromPart(const HttpPart& _part)
+void HttpMultiPart::appendPart(HttpMultiPartDevice* _device, const HttpPart& _part)
 {
-	QByteArray partData;
-    switch (_part.type()) {
+	switch (_part.type()) {
 	case HttpPart::Text: {
-        partData = makeDataFromTextPart( _part );
+		_device->appendData(makeDataFromTextPart(_part));
 		break;
 	}
 	case HttpPart::File: {
-        partData = makeDataFromFilePart( _part );
+		_device->appendData(makeFilePartHeader(_part));
+		_device->appendFile(_part.filePath());
+		_device->appendData(crlf().toUtf8());
 		break;
 	}
 	}
-	return partData;
 }
 
 QByteArray HttpMultiPart::makeDataFromTextPart(const HttpPart& _part)
@@ -161,7 +280,7 @@ QByteArray HttpMultiPart::makeDataFromTextPart(const HttpPart& _part)
 	return partData;
 }
 
-QByteArray HttpMultiPart::makeDataFromFilePart(const HttpPart& _part)
+QByteArray HttpMultiPart::makeFilePartHeader(const HttpPart& _part)
 {
 	QByteArray partData;
 
@@ -169,31 +288,20 @@ QByteArray HttpMultiPart::makeDataFromFilePart(const HttpPart& _part)
     partData.append(boundary());
     partData.append(crlf());
 
-    {
-        // Определение mime типа файла
-        QMimeDatabase mimeTypeDetector;
-        QString contentType = mimeTypeDetector.mimeTypeForFile(_part.filePath()).name();
-
-		partData.append(
-                    QString("Content-Disposition: form-data; name=\"%1\"; filename=\"%2\"%4"
-							 "Content-Type: %3%4%4"
-							 )
-                    .arg(_part.name(),
-                          _part.fileName(),
-						  contentType,
-                          crlf())
-					);
-
-        QFile uploadFile(_part.filePath());
-        uploadFile.open(QIODevice::ReadOnly);
-        while (!uploadFile.atEnd()) {
-			QByteArray readed = uploadFile.read(1024);
-            partData.append(readed);
-		}
-		uploadFile.close();
-	}
+    // Определение mime типа файла
+    QMimeDatabase mimeTypeDetector;
+    QString contentType = mimeTypeDetector.mimeTypeForFile(_part.filePath()).name();
+
+    partData.append(
+                QString("Content-Disposition: form-data; name=\"%1\"; filename=\"%2\"%4"
+                         "Content-Type: %3%4%4"
+                         )
+                .arg(_part.name(),
+                      _part.fileName(),
+                      contentType,
+                      crlf())
+                );
 
-    partData.append(crlf());
 	return partData;
 }
 
@@ -19,8 +19,11 @@
 #define HTTPMULTIPART_H
 
 #include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QIODevice>
 #include <QtCore/QString>
 #include <QtCore/QList>
+#include <QtCore/QVector>
 
 class HttpPart
 {
@@ -56,6 +59,90 @@ private:
 			m_filePath;
 };
 
+/**
+ * @brief Устройство для потокового чтения тела multipart-запроса
+ *
+ * Тело собирается из фрагментов: заголовки и текстовые части хранятся в памяти,
+ * а содержимое файлов читается с диска по мере отправки, поэтому для загрузки
+ * больших файлов не требуется держать их в памяти целиком
+ *
+ * @note Устройство должно открываться без буферизации (QIODevice::Unbuffered), т.к. позиция
+ *       чтения хранится в m_position и при буфере QIODevice расходится с pos() после seek()
+ */
+class HttpMultiPartDevice : public QIODevice
+{
+public:
+	explicit HttpMultiPartDevice(QObject* _parent = nullptr);
+
+	/**
+	 * @brief Добавить фрагмент данных из памяти
+	 */
+	void appendData(const QByteArray& _data);
+
+	/**
+	 * @brief Добавить содержимое файла
+	 */
+	void appendFile(const QString& _filePath);
+
+	/**
+	 * @brief Размер тела запроса известен заранее
+	 */
+	qint64 size() const override;
+	bool isSequential() const override;
+	bool seek(qint64 _position) override;
+
+protected:
+	qint64 readData(char* _data, qint64 _maxSize) override;
+	qint64 writeData(const char* _data, qint64 _maxSize) override;
+
+private:
+	/**
+	 * @brief Фрагмент тела запроса
+	 */
+	struct Segment {
+		/**
+		 * @brief Данные из памяти
+		 */
+		QByteArray data;
+
+		/**
+		 * @brief Путь к файлу, если фрагмент читается с диска
+		 */
+		QString filePath;
+
+		/**
+		 * @brief Смещение фрагмента от начала тела
+		 */
+		qint64 offset = 0;
+
+		/**
+		 * @brief Размер фрагмента
+		 */
+		qint64 size = 0;
+	};
+
+	/**
+	 * @brief Фрагменты тела
+	 */
+	QVector<Segment> m_segments;
+
+	/**
+	 * @brief Общий размер тела
+	 */
+	qint64 m_size = 0;
+
+	/**
+	 * @brief Позиция, с которой будет прочитана следующая порция данных
+	 */
+	qint64 m_position = 0;
+
+	/**
+	 * @brief Открытый в данный момент файл и индекс его фрагмента
+	 */
+	QFile m_file;
+	int m_fileSegment = -1;
+};
+
 class HttpMultiPart
 {
 public:
@@ -63,12 +150,26 @@ public:
     void setBoundary(const QString& _boundary);
     void addPart(const HttpPart& _part);
 
+	/**
+	 * @brief Тело запроса целиком
+	 */
 	QByteArray data();
 
+	/**
+	 * @brief Размер тела запроса
+	 */
+	qint64 size();
+
+	/**
+	 * @brief Открытое устройство для потокового чтения тела запроса
+	 * @note Владение устройством переходит к вызывающему
+	 */
+	QIODevice* device();
+
 private:
-    QByteArray makeDataFromPart(const HttpPart& _part);
+	void appendPart(HttpMultiPartDevice* _device, const HttpPart& _part);
     QByteArray makeDataFromTextPart(const HttpPart& _part);
-    QByteArray makeDataFromFilePart(const HttpPart& _part);
+    QByteArray makeFilePartHeader(const HttpPart& _part);
 	QByteArray makeEndData();
 
 private:
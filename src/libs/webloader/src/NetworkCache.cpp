@@ -0,0 +1,127 @@
+/*
+* Copyright (C) 2015-2018 Dimka Novikov, to@dimkanovikov.pro
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 3 of the License, or any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* Full license: http://dimkanovikov.pro/license/LGPLv3
+*/
+
+#include "NetworkCache.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QMultiMap>
+
+namespace {
+    /**
+     * @brief Расширение файлов с записями кэша
+     */
+    const QString kCacheFileSuffix = ".d";
+
+    /**
+     * @brief До какой доли от максимального размера очищается переполненный кэш
+     */
+    const qint64 kExpireGoalPercent = 90;
+}
+
+QAtomicInt NetworkCache::s_hits;
+QAtomicInt NetworkCache::s_misses;
+
+
+NetworkCache::NetworkCache(QObject* _parent) :
+    QNetworkDiskCache(_parent)
+{
+}
+
+void NetworkCache::registerHit()
+{
+    s_hits.ref();
+}
+
+void NetworkCache::registerMiss()
+{
+    s_misses.ref();
+}
+
+int NetworkCache::hits()
+{
+    return s_hits.load();
+}
+
+int NetworkCache::misses()
+{
+    return s_misses.load();
+}
+
+QNetworkCacheMetaData NetworkCache::metaData(const QUrl& _url)
+{
+    const QNetworkCacheMetaData metaData = QNetworkDiskCache::metaData(_url);
+    if (metaData.isValid()) {
+        m_lastAccess.insert(_url, QDateTime::currentMSecsSinceEpoch());
+    }
+    return metaData;
+}
+
+QIODevice* NetworkCache::data(const QUrl& _url)
+{
+    QIODevice* data = QNetworkDiskCache::data(_url);
+    if (data != nullptr) {
+        m_lastAccess.insert(_url, QDateTime::currentMSecsSinceEpoch());
+    }
+    return data;
+}
+
+qint64 NetworkCache::expire()
+{
+    //
+    // Соберём записи кэша, упорядочив их по времени последнего обращения,
+    // для записей, к которым не обращались в текущей сессии, используем время их сохранения
+    //
+    QMultiMap<qint64, QString> cacheFiles;
+    qint64 cacheSize = 0;
+    QDirIterator cacheIterator(cacheDirectory(), QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (cacheIterator.hasNext()) {
+        const QString filePath = cacheIterator.next();
+        if (!filePath.endsWith(kCacheFileSuffix)) {
+            continue;
+        }
+
+        const QFileInfo fileInfo = cacheIterator.fileInfo();
+        cacheSize += fileInfo.size();
+        qint64 lastAccess = fileInfo.lastModified().toMSecsSinceEpoch();
+        if (!m_lastAccess.isEmpty()) {
+            lastAccess = qMax(lastAccess, m_lastAccess.value(fileMetaData(filePath).url()));
+        }
+        cacheFiles.insert(lastAccess, filePath);
+    }
+
+    if (cacheSize <= maximumCacheSize()) {
+        return cacheSize;
+    }
+
+    //
+    // Удаляем записи, начиная с самых давно использованных, оставляя запас,
+    // чтобы не чистить кэш при каждой следующей записи
+    //
+    const qint64 goal = maximumCacheSize() * kExpireGoalPercent / 100;
+    for (auto iter = cacheFiles.constBegin(); iter != cacheFiles.constEnd() && cacheSize > goal; ++iter) {
+        if (!m_lastAccess.isEmpty()) {
+            m_lastAccess.remove(fileMetaData(iter.value()).url());
+        }
+        QFile cacheFile(iter.value());
+        const qint64 fileSize = cacheFile.size();
+        if (cacheFile.remove()) {
+            cacheSize -= fileSize;
+        }
+    }
+
+    return cacheSize;
+}
@@ -0,0 +1,87 @@
+/*
+* Copyright (C) 2015-2018 Dimka Novikov, to@dimkanovikov.pro
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 3 of the License, or any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* Full license: http://dimkanovikov.pro/license/LGPLv3
+*/
+
+#ifndef NETWORKCACHE_H
+#define NETWORKCACHE_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QNetworkDiskCache>
+#include <QUrl>
+
+
+/**
+ * @brief Дисковый кэш ответов сервера
+ *
+ * Проверку актуальности (ETag, Last-Modified, Cache-Control) выполняет QNetworkAccessManager,
+ * а кэш дополнительно вытесняет давно не использовавшиеся записи при превышении размера
+ * и ведёт статистику попаданий
+ */
+class NetworkCache : public QNetworkDiskCache
+{
+    Q_OBJECT
+
+public:
+    explicit NetworkCache(QObject* _parent = nullptr);
+
+    /**
+     * @brief Зарегистрировать ответ, полученный из кэша, либо из сети
+     * @note Методы потокобезопасны
+     */
+    /** @{ */
+    static void registerHit();
+    static void registerMiss();
+    /** @} */
+
+    /**
+     * @brief Количество ответов, полученных из кэша и из сети
+     * @note Методы потокобезопасны
+     */
+    /** @{ */
+    static int hits();
+    static int misses();
+    /** @} */
+
+    /**
+     * @brief Переопределяем для учёта времени последнего обращения к записи
+     */
+    /** @{ */
+    QNetworkCacheMetaData metaData(const QUrl& _url) override;
+    QIODevice* data(const QUrl& _url) override;
+    /** @} */
+
+protected:
+    /**
+     * @brief Вытеснить давно не использовавшиеся записи, если размер кэша превышен
+     */
+    qint64 expire() override;
+
+private:
+    /**
+     * @brief Время последнего обращения к записям в текущей сессии
+     */
+    QHash<QUrl, qint64> m_lastAccess;
+
+    /**
+     * @brief Счётчики попаданий и промахов
+     */
+    /** @{ */
+    static QAtomicInt s_hits;
+    static QAtomicInt s_misses;
+    /** @} */
+};
+
+#endif // NETWORKCACHE_H
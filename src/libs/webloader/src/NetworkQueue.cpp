@@ -16,24 +16,41 @@
 */
 
 #include "NetworkQueue.h"
+#include "NetworkRequest.h"
+#include "SharedWebLoader.h"
 #include "WebLoader.h"
 
+#include <QPointer>
+
+namespace {
+    /**
+     * @brief Максимальное количество одновременно выполняемых запросов через общий менеджер сети
+     * @note Запросы к одному хосту менеджер сети всё равно распределяет по своим соединениям
+     *       (для HTTP/1.1 не более шести на хост, для HTTP/2 одно), поэтому ограничение нужно
+     *       лишь для того, чтобы очередь сохраняла порядок запросов
+     */
+    const int kMaxSharedLoaders = 16;
+
+    /**
+     * @brief Количество приоритетов запросов
+     */
+    const int kPrioritiesCount = static_cast<int>(NetworkRequestPriority::Low) + 1;
+}
+
 
 NetworkQueue* NetworkQueue::instance() {
     static NetworkQueue queue;
     return &queue;
 }
 
-WebRequest& NetworkQueue::registerRequest()
+void NetworkQueue::setMode(NetworkQueueMode _mode)
 {
-    m_requests.append(WebRequest());
-    return m_requests.last();
+    m_mode = _mode;
 }
 
-WebRequestParameters& NetworkQueue::registerRequestParameters()
+NetworkQueueMode NetworkQueue::mode() const
 {
-    m_requestParameters.append(WebRequestParameters());
-    return m_requestParameters.last();
+    return m_mode;
 }
 
 void NetworkQueue::enqueue(NetworkRequest* _request)
@@ -41,16 +58,34 @@ void NetworkQueue::enqueue(NetworkRequest* _request)
     Q_ASSERT_X(_request, Q_FUNC_INFO, "NetworkRequest shouldn't be a null pointer");
 
     //
-    // Добавим запрос в очередь
+    // Если запрос ещё ждёт ответа от предыдущей загрузки, то он ему больше не нужен
+    //
+    detach(_request);
+
     //
+    // Подпишемся на удаление объекта, чтобы забыть о нём
+    //
+    connect(_request, &NetworkRequest::destroyed, this, &NetworkQueue::forgetRequest, Qt::UniqueConnection);
+
     NetworkQueueEntry queueEntry;
     queueEntry.request = _request;
-    m_queue.enqueue(queueEntry);
+    queueEntry.ticket = ++m_lastTicket;
+    queueEntry.key = requestKey(_request);
 
     //
-    // Подпишемся на удаление объекта, чтобы пометить его, как не нуждающийся в загрузке
+    // Если такой же запрос уже выполняется, то просто дождёмся его ответа
     //
-    connect(_request, &NetworkRequest::destroyed, [this, _request] { stop(_request); });
+    if (!queueEntry.key.isEmpty()
+        && m_joinableGroups.contains(queueEntry.key)) {
+        attach(m_joinableGroups.value(queueEntry.key), _request);
+        return;
+    }
+
+    //
+    // Добавим запрос в очередь его приоритета
+    //
+    m_queuedTickets.insert(_request, queueEntry.ticket);
+    m_queues[static_cast<int>(_request->m_requestParameters.priority())].enqueue(queueEntry);
 
     //
     // Попробуем отправить запрос на загрузку прямо сейчас
@@ -63,15 +98,16 @@ void NetworkQueue::stop(NetworkRequest* _request)
     Q_ASSERT_X(_request, Q_FUNC_INFO, "NetworkRequest shouldn't be a null pointer");
 
     //
-    // Просто помечаем запрос, как не нуждающийся в загрузке
+    // Если запрос ожидает в очереди, то помечаем его, как не нуждающийся в загрузке,
+    // сама запись будет пропущена при извлечении из очереди
     //
-    for (NetworkQueueEntry& entry : m_queue) {
-        if (entry.request == _request) {
-            entry.isNeedToLoad = false;
-            m_requests.removeAll(_request->m_request);
-            m_requestParameters.removeAll(_request->m_requestParameters);
-        }
-    }
+    m_queuedTickets.remove(_request);
+
+    //
+    // Если запрос уже выполняется, то отключаем его от загрузки, которая остановится,
+    // если её ответ больше никому не нужен
+    //
+    detach(_request);
 }
 
 void NetworkQueue::stopAll()
@@ -79,17 +115,25 @@ void NetworkQueue::stopAll()
     //
     // Очистим очередь ожидающих запросов
     //
-    m_queue.clear();
+    for (QQueue<NetworkQueueEntry>& queue : m_queues) {
+        queue.clear();
+    }
+    m_queuedTickets.clear();
 
     //
     // Остановим уже обрабатывающиеся запросы
     //
+    m_joinableGroups.clear();
     for (WebLoader* loader : m_busyLoaders) {
         loader->stop();
     }
+    for (SharedWebLoader* loader : m_sharedLoaders) {
+        loader->stop();
+    }
 }
 
-NetworkQueue::NetworkQueue()
+NetworkQueue::NetworkQueue() :
+    m_queues(kPrioritiesCount)
 {
     //
     // В нужном количестве создадим WebLoader'ы
@@ -99,83 +143,258 @@ NetworkQueue::NetworkQueue()
     }
 }
 
-void NetworkQueue::processQueue()
+QByteArray NetworkQueue::requestKey(NetworkRequest* _request)
 {
     //
-    // Если нет свободных загрузчиков или запросов на загрузку, ничего и не делаем
+    // Запросы с собственными куками могут получить разные ответы, поэтому их не объединяем
     //
-    if (m_freeLoaders.isEmpty()
-        || m_queue.isEmpty()) {
-        return;
+    if (_request->m_requestParameters.cookieJar() != nullptr) {
+        return QByteArray();
     }
 
+    QByteArray key;
+    if (_request->m_requestParameters.requestMethod() == NetworkRequestMethod::Post) {
+        key = "POST ";
+        key += _request->m_request.contentHash().toHex();
+    } else {
+        key = "GET ";
+    }
     //
-    // Извлечём запрос, который необходимо загрузить
+    // Запрос без кэша должен получить свежий ответ, а не закэшированный для соседа
+    //
+    key += _request->m_requestParameters.isCacheEnabled() ? " CACHE" : " NOCACHE";
+    key += ' ';
+    key += _request->m_request.urlToLoad().toEncoded();
+    return key;
+}
+
+void NetworkQueue::processQueue()
+{
     //
-    NetworkQueueEntry requestEntry;
-    while (!m_queue.isEmpty()) {
-        requestEntry = m_queue.dequeue();
-        if (requestEntry.isNeedToLoad) {
-            break;
+    // Отправляем на загрузку столько запросов, сколько позволяют свободные загрузчики
+    //
+    forever {
+        //
+        // Найдём самый приоритетный запрос, пропуская записи, которые уже не нуждаются в загрузке
+        //
+        QQueue<NetworkQueueEntry>* queue = nullptr;
+        for (QQueue<NetworkQueueEntry>& priorityQueue : m_queues) {
+            while (!priorityQueue.isEmpty()
+                   && m_queuedTickets.value(priorityQueue.head().request) != priorityQueue.head().ticket) {
+                priorityQueue.dequeue();
+            }
+            if (!priorityQueue.isEmpty()) {
+                queue = &priorityQueue;
+                break;
+            }
+        }
+
+        //
+        // Если нет запросов на загрузку, ничего и не делаем
+        //
+        if (queue == nullptr) {
+            return;
         }
+
+        //
+        // Если такой же запрос уже выполняется, то присоединяемся к нему
+        //
+        const NetworkQueueEntry& requestEntry = queue->head();
+        if (!requestEntry.key.isEmpty()
+            && m_joinableGroups.contains(requestEntry.key)) {
+            const NetworkQueueEntry entry = queue->dequeue();
+            m_queuedTickets.remove(entry.request);
+            attach(m_joinableGroups.value(entry.key), entry.request);
+            continue;
+        }
+
+        //
+        // Определим каким способом будет выполняться запрос и есть ли для него место
+        //
+        const bool useSharedConnection =
+                m_mode == NetworkQueueMode::SharedConnection
+                && SharedWebLoader::canLoad(requestEntry.request->m_requestParameters);
+        if (useSharedConnection) {
+            if (m_sharedLoaders.size() >= kMaxSharedLoaders) {
+                return;
+            }
+        } else {
+            if (m_freeLoaders.isEmpty()) {
+                return;
+            }
+        }
+
+        const NetworkQueueEntry entry = queue->dequeue();
+        m_queuedTickets.remove(entry.request);
+        load(entry, useSharedConnection);
     }
+}
 
-    //
-    // Если не нашли ни одного запроса, который нужно загрузить, прерываемся
-    //
-    if (!requestEntry.isNeedToLoad) {
-        return;
+void NetworkQueue::load(const NetworkQueueEntry& _entry, bool _useSharedConnection)
+{
+    const quint64 groupId = ++m_lastGroupId;
+    LoadingGroup& group = m_loadingGroups[groupId];
+    group.key = _entry.key;
+
+    NetworkRequest* request = _entry.request;
+    if (_useSharedConnection) {
+        //
+        // Загрузчик живёт в сетевом потоке, поэтому все сигналы будут доставлены в поток очереди
+        //
+        SharedWebLoader* loader = new SharedWebLoader(request->m_request, request->m_requestParameters);
+        m_sharedLoaders.append(loader);
+        connect(loader, &SharedWebLoader::finished, this, [this, groupId] { releaseGroup(groupId); });
+        group.sharedLoader = loader;
+    } else {
+        //
+        // Перемещаем загрузчик в список занятых
+        //
+        WebLoader* loader = m_freeLoaders.takeLast();
+        m_busyLoaders.append(loader);
+        //
+        // ... и конфигурируем его
+        //
+        loader->setWebRequest(request->m_request);
+        loader->setWebRequestParameters(request->m_requestParameters);
+        connect(loader, &WebLoader::finished, this, [this, groupId] { releaseGroup(groupId); });
+        group.loader = loader;
+    }
+
+    if (!group.key.isEmpty()) {
+        m_joinableGroups.insert(group.key, groupId);
+
+        //
+        // После того, как загрузчик начал отдавать результат, новые запросы его уже не получат,
+        // поэтому присоединяться к группе больше нельзя. Соединение устанавливается до подключения
+        // клиентов, чтобы группа закрылась раньше, чем они обработают ответ
+        //
+        if (_useSharedConnection) {
+            connect(group.sharedLoader, &SharedWebLoader::downloadComplete, this, [this, groupId] { closeGroup(groupId); });
+            connect(group.sharedLoader, &SharedWebLoader::error, this, [this, groupId] { closeGroup(groupId); });
+        } else {
+            connect(group.loader, static_cast<void (WebLoader::*)(QByteArray, QUrl)>(&WebLoader::downloadComplete),
+                    this, [this, groupId] { closeGroup(groupId); });
+            connect(group.loader, &WebLoader::error, this, [this, groupId] { closeGroup(groupId); });
+        }
     }
 
     //
-    // Перемещаем загрузчик в список занятых
-    //
-    WebLoader* loader = m_freeLoaders.takeLast();
-    m_busyLoaders.append(loader);
+    // Соединяем загрузчик с запросом и запускаем выполнение
     //
-    // ... конфигурируем его
+    attach(groupId, request);
+    if (_useSharedConnection) {
+        m_loadingGroups[groupId].sharedLoader->loadAsync();
+    } else {
+        m_loadingGroups[groupId].loader->loadAsync();
+    }
+}
+
+void NetworkQueue::attach(quint64 _groupId, NetworkRequest* _request)
+{
+    LoadingGroup& group = m_loadingGroups[_groupId];
+    group.requests.append(_request);
+    m_requestGroups.insert(_request, _groupId);
+
     //
-    loader->setWebRequest(requestEntry.request->m_request);
-    loader->setWebRequestParameters(requestEntry.request->m_requestParameters);
+    // Сигнал о завершении отправляется клиентам при освобождении группы
+    //
+    if (group.sharedLoader != nullptr) {
+        SharedWebLoader* loader = group.sharedLoader;
+        connect(loader, &SharedWebLoader::downloadComplete, _request, &NetworkRequest::downloadComplete);
+        connect(loader, &SharedWebLoader::uploadProgress, _request, &NetworkRequest::uploadProgress);
+        connect(loader, &SharedWebLoader::downloadProgress, _request, &NetworkRequest::downloadProgress);
+        connect(loader, &SharedWebLoader::error, _request, &NetworkRequest::error);
+        connect(loader, &SharedWebLoader::errorDetails, _request, &NetworkRequest::errorDetails);
+    } else {
+        WebLoader* loader = group.loader;
+        connect(loader, static_cast<void (WebLoader::*)(QByteArray, QUrl)>(&WebLoader::downloadComplete),
+                _request, &NetworkRequest::downloadComplete);
+        connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::uploadProgress),
+                _request, &NetworkRequest::uploadProgress);
+        connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::downloadProgress),
+                _request, &NetworkRequest::downloadProgress);
+        connect(loader, &WebLoader::error, _request, &NetworkRequest::error);
+        connect(loader, &WebLoader::errorDetails, _request, &NetworkRequest::errorDetails);
+    }
+}
+
+void NetworkQueue::detach(NetworkRequest* _request)
+{
+    const quint64 groupId = m_requestGroups.take(_request);
+    if (!m_loadingGroups.contains(groupId)) {
+        return;
+    }
+
+    LoadingGroup& group = m_loadingGroups[groupId];
+    QObject* loader = group.sharedLoader != nullptr
+                      ? static_cast<QObject*>(group.sharedLoader)
+                      : static_cast<QObject*>(group.loader);
+    disconnect(loader, nullptr, _request, nullptr);
+    group.requests.removeOne(_request);
+
     //
-    // ... соединяем с запросом
+    // Если ответ больше никому не нужен, то и загружать его незачем
     //
-    connect(loader, static_cast<void (WebLoader::*)(QByteArray, QUrl)>(&WebLoader::downloadComplete),
-            requestEntry.request, &NetworkRequest::downloadComplete);
-    connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::uploadProgress),
-            requestEntry.request, &NetworkRequest::uploadProgress);
-    connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::downloadProgress),
-            requestEntry.request, &NetworkRequest::downloadProgress);
-    connect(loader, &WebLoader::error, requestEntry.request, &NetworkRequest::error);
-    connect(loader, &WebLoader::errorDetails, requestEntry.request, &NetworkRequest::errorDetails);
-    connect(loader, &WebLoader::finished, requestEntry.request, &NetworkRequest::finished);
-    connect(loader, &WebLoader::finished, this, &NetworkQueue::reinitFinishedLoader);
+    if (group.requests.isEmpty()) {
+        stopGroup(groupId);
+    }
+}
+
+void NetworkQueue::closeGroup(quint64 _groupId)
+{
+    const QByteArray key = m_loadingGroups.value(_groupId).key;
+    if (!key.isEmpty()
+        && m_joinableGroups.value(key) == _groupId) {
+        m_joinableGroups.remove(key);
+    }
+}
+
+void NetworkQueue::stopGroup(quint64 _groupId)
+{
     //
-    // ... и запускаем выполнение
+    // К останавливаемой загрузке уже нельзя присоединиться
     //
-    loader->loadAsync();
+    closeGroup(_groupId);
+
+    const LoadingGroup group = m_loadingGroups.value(_groupId);
+    if (group.sharedLoader != nullptr) {
+        group.sharedLoader->stop();
+    } else if (group.loader != nullptr) {
+        group.loader->stop();
+    }
 }
 
-void NetworkQueue::reinitFinishedLoader()
+void NetworkQueue::releaseGroup(quint64 _groupId)
 {
-    WebLoader* loader = qobject_cast<WebLoader*>(sender());
-    if (loader == nullptr) {
-        return;
-    }
+    closeGroup(_groupId);
+    const LoadingGroup group = m_loadingGroups.take(_groupId);
 
     //
-    // Отключаем загрузчик от всех соединений
+    // Освобождаем загрузчик
     //
-    loader->disconnect();
+    if (group.sharedLoader != nullptr) {
+        m_sharedLoaders.removeOne(group.sharedLoader);
+        group.sharedLoader->deleteLater();
+    } else if (group.loader != nullptr) {
+        group.loader->disconnect();
+        m_busyLoaders.removeOne(group.loader);
+        m_freeLoaders.append(group.loader);
+    }
 
     //
-    // Если загрузчик был в списке занятых, исключаем его оттуда и переводим в список свободных
+    // Уведомляем клиентов о завершении, учитывая, что в обработчиках они могут быть удалены
     //
-    const int loaderIndex = m_busyLoaders.indexOf(loader);
-    const int invalidIndex = -1;
-    if (loaderIndex != invalidIndex) {
-        m_busyLoaders.takeAt(loaderIndex);
-        m_freeLoaders.append(loader);
+    QVector<QPointer<NetworkRequest>> requests;
+    for (NetworkRequest* request : group.requests) {
+        if (m_requestGroups.value(request) == _groupId) {
+            m_requestGroups.remove(request);
+        }
+        requests.append(request);
+    }
+    for (const QPointer<NetworkRequest>& request : requests) {
+        if (!request.isNull()) {
+            emit request->finished();
+        }
     }
 
     //
@@ -183,3 +402,13 @@ void NetworkQueue::reinitFinishedLoader()
     //
     processQueue();
 }
+
+void NetworkQueue::forgetRequest(QObject* _request)
+{
+    //
+    // Объект уже разрушается, поэтому используем указатель только в качестве ключа
+    //
+    NetworkRequest* request = static_cast<NetworkRequest*>(_request);
+    m_queuedTickets.remove(request);
+    detach(request);
+}
@@ -18,19 +18,24 @@
 #ifndef NETWORKQUEUE_H
 #define NETWORKQUEUE_H
 
-#include "WebRequest.h"
-#include "WebRequestParameters.h"
+#include "NetworkTypes.h"
 
+#include <QHash>
 #include <QObject>
 #include <QQueue>
+#include <QVector>
 
 class NetworkRequest;
+class SharedWebLoader;
 class WebLoader;
 
 
 /**
  * @brief Класс, реализующий очередь запросов
  * Реализован как паттерн Singleton
+ *
+ * Запросы распределяются по приоритетам, а одинаковые запросы (метод, ссылка, данные и использование кэша),
+ * выполняющиеся одновременно, загружаются один раз и получают общий ответ
  */
 class NetworkQueue : public QObject
 {
@@ -44,14 +49,15 @@ public:
 
 public:
     /**
-     * @brief Зарегистрировать запрос
+     * @brief Установить режим выполнения запросов
+     * @note Влияет только на запросы, которые ещё не начали выполняться
      */
-    WebRequest& registerRequest();
+    void setMode(NetworkQueueMode _mode);
 
     /**
-     * @brief Зарегистрировать параметры запроса
+     * @brief Текущий режим выполнения запросов
      */
-    WebRequestParameters& registerRequestParameters();
+    NetworkQueueMode mode() const;
 
     /**
      * @brief Добавить запрос в очередь
@@ -60,7 +66,9 @@ public:
 
     /**
      * @brief Запросить остановку запроса
-     * @note Метод не гарантирует остановку запроса, если он уже выполняется, для этого стоит использовать stopAll
+     * @note Запрос отключается от выполняющейся загрузки и больше не получает её сигналов.
+     *       Если ответ ждут другие клиенты, то для них загрузка продолжится,
+     *       для гарантированной остановки стоит использовать stopAll
      */
     void stop(NetworkRequest* _request);
 
@@ -78,27 +86,99 @@ private:
     NetworkQueue(const NetworkQueue&);
     NetworkQueue& operator=(const NetworkQueue&);
 
+    /**
+     * @brief Объект очереди на загрузку
+     */
+    struct NetworkQueueEntry {
+        /**
+         * @brief Объект запроса
+         */
+        NetworkRequest* request = nullptr;
+
+        /**
+         * @brief Номер постановки запроса в очередь
+         * @note Запись актуальна, только пока номер совпадает с сохранённым в m_queuedTickets
+         */
+        quint64 ticket = 0;
+
+        /**
+         * @brief Ключ для объединения одинаковых запросов
+         */
+        QByteArray key;
+    };
+
+    /**
+     * @brief Группа клиентов, ожидающих ответ одного загрузчика
+     */
+    struct LoadingGroup {
+        /**
+         * @brief Ключ, по которому к группе могут присоединиться одинаковые запросы
+         */
+        QByteArray key;
+
+        /**
+         * @brief Загрузчик, работающий в отдельном потоке
+         */
+        WebLoader* loader = nullptr;
+
+        /**
+         * @brief Загрузчик, работающий через общий менеджер сети
+         */
+        SharedWebLoader* sharedLoader = nullptr;
+
+        /**
+         * @brief Клиенты, ожидающие ответа
+         */
+        QVector<NetworkRequest*> requests;
+    };
+
+    /**
+     * @brief Сформировать ключ для объединения одинаковых запросов
+     * @return Пустой ключ, если запрос не может разделять ответ с другими
+     */
+    static QByteArray requestKey(NetworkRequest* _request);
+
     /**
      * @brief Выполнить шаг обработки очереди
      */
     void processQueue();
 
     /**
-     * @brief Перенастроить загрузчик завершивший свою работу
+     * @brief Запустить загрузку запроса
      */
-    void reinitFinishedLoader();
+    void load(const NetworkQueueEntry& _entry, bool _useSharedConnection);
 
-private:
     /**
-     * @brief Список зарегистрированных (потенциальных) запросов
+     * @brief Подключить запрос к группе, чтобы он получил ответ её загрузчика
      */
-    QVector<WebRequest> m_requests;
+    void attach(quint64 _groupId, NetworkRequest* _request);
 
     /**
-     * @brief Список зарегистрированных параметров запросов
+     * @brief Отключить запрос от выполняющейся загрузки
      */
-    QVector<WebRequestParameters> m_requestParameters;
+    void detach(NetworkRequest* _request);
 
+    /**
+     * @brief Запретить новым запросам присоединяться к группе
+     */
+    void closeGroup(quint64 _groupId);
+
+    /**
+     * @brief Остановить загрузчик группы
+     */
+    void stopGroup(quint64 _groupId);
+
+    /**
+     * @brief Освободить загрузчик группы, завершившей работу, и уведомить клиентов
+     */
+    void releaseGroup(quint64 _groupId);
+
+    /**
+     * @brief Забыть об удалённом запросе
+     */
+    void forgetRequest(QObject* _request);
+
+private:
     /**
      * @brief Свободные загрузчики
      */
@@ -110,24 +190,50 @@ private:
     QVector<WebLoader*> m_busyLoaders;
 
     /**
-     * @brief Объект очереди на загрузку
+     * @brief Режим выполнения запросов
      */
-    struct NetworkQueueEntry {
-        /**
-         * @brief Необходимо ли загрузить
-         */
-        bool isNeedToLoad = true;
+    NetworkQueueMode m_mode = NetworkQueueMode::SharedConnection;
 
-        /**
-         * @brief Объект запроса
-         */
-        NetworkRequest* request = nullptr;
-    };
+    /**
+     * @brief Загрузчики, выполняющие запросы через общий менеджер сети
+     */
+    QVector<SharedWebLoader*> m_sharedLoaders;
+
+    /**
+     * @brief Очереди запросов, по одной на каждый приоритет
+     */
+    QVector<QQueue<NetworkQueueEntry>> m_queues;
+
+    /**
+     * @brief Актуальные номера постановки в очередь ожидающих запросов
+     * @note Остановка запроса лишь удаляет его номер, а запись в очереди пропускается при извлечении
+     */
+    QHash<NetworkRequest*, quint64> m_queuedTickets;
+
+    /**
+     * @brief Последний выданный номер постановки в очередь
+     */
+    quint64 m_lastTicket = 0;
+
+    /**
+     * @brief Выполняющиеся загрузки
+     */
+    QHash<quint64, LoadingGroup> m_loadingGroups;
+
+    /**
+     * @brief Загрузки, к которым могут присоединиться одинаковые запросы, по ключу запроса
+     */
+    QHash<QByteArray, quint64> m_joinableGroups;
+
+    /**
+     * @brief Загрузка, ответ которой ждёт запрос
+     */
+    QHash<NetworkRequest*, quint64> m_requestGroups;
 
     /**
-     * @brief Собственно очередь запросов
+     * @brief Последний выданный идентификатор загрузки
      */
-    QQueue<NetworkQueueEntry> m_queue;
+    quint64 m_lastGroupId = 0;
 };
 
 #endif // NETWORKQUEUE_H
@@ -16,6 +16,7 @@
 */
 
 #include "NetworkRequest.h"
+#include "NetworkCache.h"
 #include "NetworkQueue.h"
 #include "WebLoader.h"
 #include "WebRequest.h"
@@ -29,10 +30,18 @@ void NetworkRequest::stopAllConnections()
     NetworkQueue::instance()->stopAll();
 }
 
+int NetworkRequest::cacheHits()
+{
+    return NetworkCache::hits();
+}
+
+int NetworkRequest::cacheMisses()
+{
+    return NetworkCache::misses();
+}
+
 NetworkRequest::NetworkRequest(QObject* _parent) :
-    QObject(_parent),
-    m_request(NetworkQueue::instance()->registerRequest()),
-    m_requestParameters(NetworkQueue::instance()->registerRequestParameters())
+    QObject(_parent)
 {
     connect(this, &NetworkRequest::downloadComplete, [this] (const QByteArray& _downloadedData) {
         m_downloadedData = _downloadedData;
@@ -72,6 +81,28 @@ int NetworkRequest::loadingTimeout() const
     return m_requestParameters.loadingTimeout();
 }
 
+void NetworkRequest::setPriority(NetworkRequestPriority _priority)
+{
+    stop();
+    m_requestParameters.setPriority(_priority);
+}
+
+NetworkRequestPriority NetworkRequest::priority() const
+{
+    return m_requestParameters.priority();
+}
+
+void NetworkRequest::setCacheEnabled(bool _enabled)
+{
+    stop();
+    m_requestParameters.setCacheEnabled(_enabled);
+}
+
+bool NetworkRequest::isCacheEnabled() const
+{
+    return m_requestParameters.isCacheEnabled();
+}
+
 void NetworkRequest::clearRequestAttributes()
 {
     stop();
@@ -114,6 +145,11 @@ void NetworkRequest::loadAsync(const QUrl& _urlToLoad, const QUrl& _referer)
     //
     NetworkQueue::instance()->stop(this);
 
+    //
+    // Ответ предыдущей загрузки к новой отношения не имеет
+    //
+    m_downloadedData.clear();
+
     //
     // Настраиваем параметры и кладем в очередь
     //
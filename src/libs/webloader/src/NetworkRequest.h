@@ -20,14 +20,14 @@
 
 #include "NetworkTypes.h"
 #include "WebLoaderGlobal.h"
+#include "WebRequest.h"
+#include "WebRequestParameters.h"
 
 #include <QObject>
 #include <QUrl>
 
 class NetworkRequestPrivate;
 class QNetworkCookieJar;
-class WebRequest;
-class WebRequestParameters;
 
 /**
  * @brief Пользовательский класс для создания GET и POST запросов
@@ -44,6 +44,15 @@ public:
      */
     static void stopAllConnections();
 
+    /**
+     * @brief Количество ответов, полученных из дискового кэша и из сети, для диагностики
+     * @note Учитываются только запросы, для которых включено использование кэша
+     */
+    /** @{ */
+    static int cacheHits();
+    static int cacheMisses();
+    /** @} */
+
 public:
     explicit NetworkRequest(QObject* _parent = nullptr);
 
@@ -77,6 +86,27 @@ public:
      */
     int loadingTimeout() const;
 
+    /**
+     * @brief Установка приоритета запроса в очереди
+     */
+    void setPriority(NetworkRequestPriority _priority);
+
+    /**
+     * @brief Получение приоритета запроса в очереди
+     */
+    NetworkRequestPriority priority() const;
+
+    /**
+     * @brief Установка возможности использовать дисковый кэш ответов
+     * @note Кэш работает только для GET-запросов в режиме общего менеджера сети
+     */
+    void setCacheEnabled(bool _enabled);
+
+    /**
+     * @brief Можно ли использовать дисковый кэш ответов
+     */
+    bool isCacheEnabled() const;
+
     /**
      * @brief Очистить все старые атрибуты запроса
      */
@@ -157,14 +187,14 @@ signals:
 
 private:
     /**
-     * @brief Ссылка на запроса
+     * @brief Запрос
      */
-    WebRequest& m_request;
+    WebRequest m_request;
 
     /**
-     * @brief Ссылка на параметры запроса
+     * @brief Параметры запроса
      */
-    WebRequestParameters& m_requestParameters;
+    WebRequestParameters m_requestParameters;
 
     /**
      * @brief Загруженные данные в случае, если используется синхронная загрузка
@@ -10,4 +10,39 @@ enum class NetworkRequestMethod {
     Post
 };
 
+/**
+ * @enum Приоритет запроса в очереди
+ */
+enum class NetworkRequestPriority {
+    /**
+     * @brief Запросы, результата которых ждёт пользователь (например, синхронизация)
+     */
+    High,
+
+    /**
+     * @brief Обычные запросы
+     */
+    Normal,
+
+    /**
+     * @brief Фоновые загрузки (аватары, проверка обновлений, словари)
+     */
+    Low
+};
+
+/**
+ * @enum Режим выполнения запросов очередью
+ */
+enum class NetworkQueueMode {
+    /**
+     * @brief Каждый загрузчик работает в собственном потоке со своим менеджером сети
+     */
+    LoaderThreads,
+
+    /**
+     * @brief Все запросы выполняются в общем сетевом потоке через единый менеджер сети
+     */
+    SharedConnection
+};
+
 #endif // NETWORKTYPES_H
@@ -0,0 +1,300 @@
+/*
+* Copyright (C) 2015-2018 Dimka Novikov, to@dimkanovikov.pro
+* Copyright (C) 2016 Alexey Polushkin, armijo38@yandex.ru
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 3 of the License, or any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* Full license: http://dimkanovikov.pro/license/LGPLv3
+*/
+
+#include "SharedWebLoader.h"
+#include "NetworkCache.h"
+#include "WebLoader.h"
+
+#include <QDir>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
+
+namespace {
+    /**
+     * @brief Не все сайты передают суммарный размер загружаемой страницы,
+     *		  поэтому для отображения прогресса загрузки используется
+     *		  заранее заданное число (средний размер веб-страницы)
+     */
+    const int kPossibleRecievedMaxFileSize = 120000;
+
+    /**
+     * @brief Максимальный размер дискового кэша ответов
+     */
+    const qint64 kMaxCacheSize = 50 * 1024 * 1024;
+
+    /**
+     * @brief Сетевой поток с единственным на всё приложение менеджером сети
+     */
+    class NetworkThread
+    {
+    public:
+        NetworkThread() :
+            manager(new QNetworkAccessManager)
+        {
+            thread.setObjectName("WebLoaderNetworkThread");
+            //
+            // Кэш используется только теми запросами, которые это явно разрешили
+            //
+            NetworkCache* cache = new NetworkCache;
+            cache->setCacheDirectory(
+                        QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                        + QDir::separator() + "webloader");
+            cache->setMaximumCacheSize(kMaxCacheSize);
+            manager->setCache(cache);
+            manager->moveToThread(&thread);
+            QObject::connect(&thread, &QThread::finished, manager, &QObject::deleteLater);
+            thread.start();
+        }
+
+        ~NetworkThread()
+        {
+            thread.quit();
+            thread.wait();
+        }
+
+        /**
+         * @brief Поток, в котором обрабатываются все сетевые события
+         */
+        QThread thread;
+
+        /**
+         * @brief Менеджер сети, хранящий пул открытых соединений
+         */
+        QNetworkAccessManager* manager = nullptr;
+    };
+}
+
+
+SharedWebLoader::SharedWebLoader(const WebRequest& _request, const WebRequestParameters& _parameters) :
+    QObject(nullptr),
+    m_request(_request),
+    m_parameters(_parameters)
+{
+    moveToThread(networkManager()->thread());
+}
+
+SharedWebLoader::~SharedWebLoader()
+{
+    if (!m_reply.isNull()) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+}
+
+bool SharedWebLoader::canLoad(const WebRequestParameters& _parameters)
+{
+    return _parameters.cookieJar() == nullptr;
+}
+
+void SharedWebLoader::loadAsync()
+{
+    QMetaObject::invokeMethod(this, "startLoading", Qt::QueuedConnection);
+}
+
+void SharedWebLoader::stop()
+{
+    m_isNeedStop.storeRelease(true);
+    QMetaObject::invokeMethod(this, "abortLoading", Qt::QueuedConnection);
+}
+
+void SharedWebLoader::startLoading()
+{
+    if (m_isNeedStop.loadAcquire()) {
+        finish();
+        return;
+    }
+
+    m_requestSourceUrl = m_request.urlToLoad();
+
+    //
+    // Таймер для прерывания работы
+    //
+    m_timeoutTimer = new QTimer(this);
+    m_timeoutTimer->setSingleShot(true);
+    connect(m_timeoutTimer, &QTimer::timeout, this, [this] {
+        if (!m_reply.isNull()) {
+            m_reply->abort();
+        }
+    });
+
+    sendRequest();
+}
+
+void SharedWebLoader::abortLoading()
+{
+    //
+    // Если запрос уже отправлен, то прерываем его, а завершение будет обработано в handleReplyFinished
+    //
+    if (!m_reply.isNull()) {
+        m_reply->abort();
+    } else {
+        finish();
+    }
+}
+
+void SharedWebLoader::sendRequest()
+{
+    emit uploadProgress(0, m_requestSourceUrl);
+    emit downloadProgress(0, m_requestSourceUrl);
+
+    const bool isPost = m_parameters.requestMethod() == NetworkRequestMethod::Post;
+    QNetworkRequest request = m_request.networkRequest(isPost);
+    //
+    // Разрешаем мультиплексирование запросов в одном соединении, если сервер его поддерживает,
+    // для HTTP/1.1 соединения и так остаются открытыми и переиспользуются менеджером
+    //
+#if QT_VERSION >= 0x050800
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+    //
+    // Кэшированный ответ используется, пока он актуален, а после этого перепроверяется
+    // на сервере по ETag и Last-Modified
+    //
+    if (m_parameters.isCacheEnabled()) {
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, true);
+    } else {
+        request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
+        request.setAttribute(QNetworkRequest::CacheSaveControlAttribute, false);
+    }
+
+    QNetworkAccessManager* manager = networkManager();
+    if (isPost) {
+        //
+        // Тело запроса читается с устройства по мере отправки и удаляется вместе с ответом
+        //
+        QIODevice* data = m_request.multiPartDevice();
+        m_reply = manager->post(request, data);
+        data->setParent(m_reply.data());
+    } else {
+        m_reply = manager->get(request);
+    }
+
+    connect(m_reply.data(), &QNetworkReply::uploadProgress, this, &SharedWebLoader::handleUploadProgress);
+    connect(m_reply.data(), &QNetworkReply::downloadProgress, this, &SharedWebLoader::handleDownloadProgress);
+    connect(m_reply.data(), static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
+            this, &SharedWebLoader::handleDownloadError);
+    connect(m_reply.data(), &QNetworkReply::sslErrors, this, &SharedWebLoader::handleSslErrors);
+    connect(m_reply.data(), &QNetworkReply::sslErrors,
+            m_reply.data(), static_cast<void (QNetworkReply::*)()>(&QNetworkReply::ignoreSslErrors));
+    connect(m_reply.data(), &QNetworkReply::finished, this, &SharedWebLoader::handleReplyFinished);
+
+    m_timeoutTimer->start(m_parameters.loadingTimeout());
+}
+
+void SharedWebLoader::handleUploadProgress(qint64 _uploadedBytes, qint64 _totalBytes)
+{
+    m_timeoutTimer->start();
+
+    if (_totalBytes > 0) {
+        emit uploadProgress(((float)_uploadedBytes / _totalBytes) * 100, m_requestSourceUrl);
+    }
+}
+
+void SharedWebLoader::handleDownloadProgress(qint64 _recievedBytes, qint64 _totalBytes)
+{
+    m_timeoutTimer->start();
+
+    if (_totalBytes < 0) {
+        _totalBytes = kPossibleRecievedMaxFileSize;
+    }
+    emit downloadProgress(((float)_recievedBytes / _totalBytes) * 100, m_requestSourceUrl);
+}
+
+void SharedWebLoader::handleReplyFinished()
+{
+    QNetworkReply* reply = m_reply.data();
+    m_reply.clear();
+    if (reply == nullptr) {
+        return;
+    }
+
+    reply->deleteLater();
+    m_timeoutTimer->stop();
+
+    if (m_isNeedStop.loadAcquire()) {
+        finish();
+        return;
+    }
+
+    //
+    // Если требуется редирект, то отправляем новый запрос по тому же соединению
+    //
+    const QVariant redirectUrl = reply->header(QNetworkRequest::LocationHeader);
+    if (!redirectUrl.isNull()
+        && reply->error() == QNetworkReply::NoError) {
+        m_request.setUrlReferer(m_request.urlToLoad());
+        m_request.setUrlToLoad(reply->url().resolved(redirectUrl.toUrl()));
+        m_parameters.setRequestMethod(NetworkRequestMethod::Get); // Редирект всегда методом Get
+        sendRequest();
+        return;
+    }
+
+    if (m_parameters.isCacheEnabled()) {
+        if (reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool()) {
+            NetworkCache::registerHit();
+        } else {
+            NetworkCache::registerMiss();
+        }
+    }
+
+    emit downloadComplete(reply->readAll(), m_requestSourceUrl);
+    finish();
+}
+
+void SharedWebLoader::handleDownloadError(QNetworkReply::NetworkError _networkError)
+{
+    if (_networkError == QNetworkReply::NoError
+        || m_isNeedStop.loadAcquire()) {
+        return;
+    }
+
+    emit error(WebLoader::errorMessage(_networkError), m_requestSourceUrl);
+}
+
+void SharedWebLoader::handleSslErrors(const QList<QSslError>& _errors)
+{
+    QString lastErrorDetails;
+    for (const QSslError& error : _errors) {
+        if (!lastErrorDetails.isEmpty()) {
+            lastErrorDetails.append("\n");
+        }
+        lastErrorDetails.append(error.errorString());
+    }
+
+    emit errorDetails(lastErrorDetails, m_requestSourceUrl);
+}
+
+void SharedWebLoader::finish()
+{
+    if (m_isFinished) {
+        return;
+    }
+
+    m_isFinished = true;
+    emit finished();
+}
+
+QNetworkAccessManager* SharedWebLoader::networkManager()
+{
+    static NetworkThread networkThread;
+    return networkThread.manager;
+}
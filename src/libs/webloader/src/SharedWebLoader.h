@@ -0,0 +1,185 @@
+/*
+* Copyright (C) 2015-2018 Dimka Novikov, to@dimkanovikov.pro
+* Copyright (C) 2016 Alexey Polushkin, armijo38@yandex.ru
+*
+* This library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation; either
+* version 3 of the License, or any later version.
+*
+* This library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+* Lesser General Public License for more details.
+*
+* Full license: http://dimkanovikov.pro/license/LGPLv3
+*/
+
+#ifndef SHAREDWEBLOADER_H
+#define SHAREDWEBLOADER_H
+
+#include "WebRequest.h"
+#include "WebRequestParameters.h"
+
+#include <QAtomicInt>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+
+class QNetworkAccessManager;
+class QTimer;
+
+
+/**
+ * @brief Загрузчик, работающий через общий для всех запросов менеджер сети
+ *
+ * В отличие от WebLoader не создаёт собственный поток и собственный QNetworkAccessManager,
+ * а выполняет запрос в едином сетевом потоке. За счёт этого соединения (в т.ч. TLS-сессии
+ * и HTTP/2-соединения) переиспользуются между запросами к одному хосту
+ */
+class SharedWebLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    SharedWebLoader(const WebRequest& _request, const WebRequestParameters& _parameters);
+    ~SharedWebLoader();
+
+    /**
+     * @brief Может ли запрос с заданными параметрами выполняться через общий менеджер сети
+     * @note Запросы с собственными куками требуют отдельного менеджера
+     */
+    static bool canLoad(const WebRequestParameters& _parameters);
+
+    /**
+     * @brief Отправка запроса (асинхронное выполнение)
+     * @note Метод можно вызывать из любого потока
+     */
+    void loadAsync();
+
+    /**
+     * @brief Остановить выполнение
+     * @note Метод можно вызывать из любого потока
+     */
+    void stop();
+
+signals:
+    /**
+     * @brief Прогресс отправки запроса на сервер
+     */
+    void uploadProgress(int, QUrl);
+
+    /**
+     * @brief Прогресс загрузки данных с сервера
+     */
+    void downloadProgress(int, QUrl);
+
+    /**
+     * @brief Данные загружены
+     */
+    void downloadComplete(QByteArray, QUrl);
+
+    /**
+     * @brief Сообщение об ошибке при загрузке
+     */
+    /** @{ */
+    void error(QString, QUrl);
+    void errorDetails(QString, QUrl);
+    /** @} */
+
+    /**
+     * @brief Выполнение запроса завершено
+     */
+    void finished();
+
+private slots:
+    /**
+     * @brief Начать загрузку в сетевом потоке
+     */
+    void startLoading();
+
+    /**
+     * @brief Прервать загрузку в сетевом потоке
+     */
+    void abortLoading();
+
+private:
+    /**
+     * @brief Отправить очередной запрос (исходный, либо по редиректу)
+     */
+    void sendRequest();
+
+    /**
+     * @brief Прогресс отправки запроса на сервер
+     */
+    void handleUploadProgress(qint64 _uploadedBytes, qint64 _totalBytes);
+
+    /**
+     * @brief Прогресс загрузки данных с сервера
+     */
+    void handleDownloadProgress(qint64 _recievedBytes, qint64 _totalBytes);
+
+    /**
+     * @brief Ответ на запрос получен
+     */
+    void handleReplyFinished();
+
+    /**
+     * @brief Ошибка при загрузки страницы
+     */
+    void handleDownloadError(QNetworkReply::NetworkError _networkError);
+
+    /**
+     * @brief Ошибки при защищённом подключении
+     */
+    void handleSslErrors(const QList<QSslError>& _errors);
+
+    /**
+     * @brief Завершить работу загрузчика
+     */
+    void finish();
+
+    /**
+     * @brief Общий менеджер сети, живущий в сетевом потоке
+     */
+    static QNetworkAccessManager* networkManager();
+
+private:
+    /**
+     * @brief Объект запроса
+     */
+    WebRequest m_request;
+
+    /**
+     * @brief Параметры запроса
+     */
+    WebRequestParameters m_parameters;
+
+    /**
+     * @brief Исходная ссылка для загрузки
+     */
+    QUrl m_requestSourceUrl;
+
+    /**
+     * @brief Текущий ответ сервера
+     */
+    QPointer<QNetworkReply> m_reply;
+
+    /**
+     * @brief Таймер для прерывания зависших запросов
+     */
+    QTimer* m_timeoutTimer = nullptr;
+
+    /**
+     * @brief Необходимо ли остановить выполнение
+     * @note Устанавливается из потока клиента, а читается в сетевом потоке
+     */
+    QAtomicInt m_isNeedStop;
+
+    /**
+     * @brief Завершена ли работа загрузчика
+     */
+    bool m_isFinished = false;
+};
+
+#endif // SHAREDWEBLOADER_H
@@ -162,9 +162,13 @@ void WebLoader::run()
             }
 
             case NetworkRequestMethod::Post: {
+                //
+                // Тело запроса читается с устройства по мере отправки и удаляется вместе с ответом
+                //
                 const QNetworkRequest networkRequest = m_request.networkRequest(true);
-                const QByteArray data = m_request.multiPartData();
+                QIODevice* data = m_request.multiPartDevice();
                 reply = m_networkManager->post(networkRequest, data);
+                data->setParent(reply.data());
                 break;
             }
 
@@ -245,6 +249,12 @@ void WebLoader::stop()
     }
 }
 
+QString WebLoader::errorMessage(QNetworkReply::NetworkError _networkError)
+{
+    return tr("Sorry, we have some error while loading. Error is: %1")
+            .arg(networkErrorToString(_networkError));
+}
+
 void WebLoader::uploadProgress(qint64 _uploadedBytes, qint64 _totalBytes)
 {
     //! отправлено [uploaded] байт из [total]
@@ -307,10 +317,7 @@ void WebLoader::downloadError(QNetworkReply::NetworkError _networkError)
         }
 
         default: {
-            const QString lastError =
-                    tr("Sorry, we have some error while loading. Error is: %1")
-                    .arg(networkErrorToString(_networkError));
-            emit error(lastError, m_requestSourceUrl);
+            emit error(errorMessage(_networkError), m_requestSourceUrl);
             break;
         }
     }
@@ -63,6 +63,11 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Сформировать сообщение об ошибке загрузки
+     */
+    static QString errorMessage(QNetworkReply::NetworkError _networkError);
+
 signals:
     /**
      * @brief Прогресс отправки запроса на сервер
@@ -19,7 +19,11 @@
 #include "HttpMultiPart.h"
 
 
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QStringList>
 #include <QSslConfiguration>
 #include <QMimeDatabase>
@@ -164,7 +168,7 @@ QNetworkRequest WebRequest::networkRequest(bool _addContentHeaders)
         } else {
             request.setHeader(QNetworkRequest::ContentTypeHeader, kContentType);
         }
-        request.setHeader(QNetworkRequest::ContentLengthHeader, multiPartData().size());
+        request.setHeader(QNetworkRequest::ContentLengthHeader, multiPartSize());
     }
 
     return request;
@@ -172,10 +176,65 @@ QNetworkRequest WebRequest::networkRequest(bool _addContentHeaders)
 
 QByteArray WebRequest::multiPartData()
 {
-    if(m_useRawData) {
+    if (m_useRawData) {
         return m_rawData;
     }
 
+    return multiPart().data();
+}
+
+qint64 WebRequest::multiPartSize()
+{
+    if (m_useRawData) {
+        return m_rawData.size();
+    }
+
+    return multiPart().size();
+}
+
+QIODevice* WebRequest::multiPartDevice()
+{
+    if (m_useRawData) {
+        QBuffer* buffer = new QBuffer;
+        buffer->setData(m_rawData);
+        buffer->open(QIODevice::ReadOnly);
+        return buffer;
+    }
+
+    return multiPart().device();
+}
+
+QByteArray WebRequest::contentHash() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (m_useRawData) {
+        hash.addData(m_rawData);
+        return hash.result();
+    }
+
+    for (const QPair<QString, QVariant>& attribute : m_attributes) {
+        hash.addData(attribute.first.toUtf8());
+        hash.addData("=", 1);
+        hash.addData(attribute.second.toString().toUtf8());
+        hash.addData("&", 1);
+    }
+    //
+    // Содержимое файлов не читаем, а учитываем их путь, размер и время изменения
+    //
+    for (const QPair<QString, QString>& attributeFile : m_attributeFiles) {
+        const QFileInfo fileInfo(attributeFile.second);
+        hash.addData(attributeFile.first.toUtf8());
+        hash.addData("=", 1);
+        hash.addData(fileInfo.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(fileInfo.size()));
+        hash.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+        hash.addData("&", 1);
+    }
+    return hash.result();
+}
+
+HttpMultiPart WebRequest::multiPart() const
+{
     HttpMultiPart multiPart;
     multiPart.setBoundary(kBoundary);
 
@@ -203,7 +262,7 @@ QByteArray WebRequest::multiPartData()
         multiPart.addPart(filePart);
     }
 
-    return multiPart.data();
+    return multiPart;
 }
 
 QVector<QPair<QString, QVariant>> WebRequest::attributes() const
@@ -18,6 +18,8 @@
 #ifndef WEBREQUEST_H
 #define WEBREQUEST_H
 
+#include "HttpMultiPart.h"
+
 #include <QNetworkRequest>
 #include <QString>
 #include <QVariant>
@@ -93,10 +95,33 @@ public:
 
     /**
      * @breif Получить данные запроса
+     * @note Файлы загружаются в память целиком, для отправки лучше использовать multiPartDevice
      */
     QByteArray  multiPartData();
 
+    /**
+     * @brief Получить размер данных запроса, не формируя их
+     */
+    qint64 multiPartSize();
+
+    /**
+     * @brief Получить открытое устройство для потокового чтения данных запроса
+     * @note Владение устройством переходит к вызывающему
+     */
+    QIODevice* multiPartDevice();
+
+    /**
+     * @brief Хэш данных запроса
+     * @note Для файлов учитывается не содержимое, а путь, размер и время изменения
+     */
+    QByteArray contentHash() const;
+
 private:
+    /**
+     * @brief Сформировать multipart-представление атрибутов запроса
+     */
+    HttpMultiPart multiPart() const;
+
     /**
      * @brief Текстовые атрибуты запроса
      */
@@ -52,6 +52,26 @@ int WebRequestParameters::loadingTimeout() const
     return m_loadingTimeout;
 }
 
+void WebRequestParameters::setPriority(NetworkRequestPriority _priority)
+{
+    m_priority = _priority;
+}
+
+NetworkRequestPriority WebRequestParameters::priority() const
+{
+    return m_priority;
+}
+
+void WebRequestParameters::setCacheEnabled(bool _enabled)
+{
+    m_isCacheEnabled = _enabled;
+}
+
+bool WebRequestParameters::isCacheEnabled() const
+{
+    return m_isCacheEnabled;
+}
+
 bool operator==(const WebRequestParameters& _lhs, const WebRequestParameters& _rhs)
 {
     return &_lhs == &_rhs;
@@ -60,6 +60,26 @@ public:
      */
     int loadingTimeout() const;
 
+    /**
+     * @brief Установка приоритета запроса
+     */
+    void setPriority(NetworkRequestPriority _priority);
+
+    /**
+     * @brief Получение приоритета запроса
+     */
+    NetworkRequestPriority priority() const;
+
+    /**
+     * @brief Установка возможности использовать дисковый кэш ответов
+     */
+    void setCacheEnabled(bool _enabled);
+
+    /**
+     * @brief Можно ли использовать дисковый кэш ответов
+     */
+    bool isCacheEnabled() const;
+
 private:
     /**
      * @brief Куки процесса
@@ -75,6 +95,16 @@ private:
      * @brief Таймаут загрузки ссылки, милисекунд
      */
     int m_loadingTimeout = 20000;
+
+    /**
+     * @brief Приоритет запроса
+     */
+    NetworkRequestPriority m_priority = NetworkRequestPriority::Normal;
+
+    /**
+     * @brief Использовать ли дисковый кэш ответов
+     */
+    bool m_isCacheEnabled = false;
 };
 
 /**
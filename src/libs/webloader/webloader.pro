@@ -41,8 +41,10 @@ HEADERS += \
     src/WebLoaderGlobal.h \
     src/WebRequest.h \
     src/WebLoader.h \
+    src/SharedWebLoader.h \
     src/HttpMultiPart.h \
     src/NetworkQueue.h \
+    src/NetworkCache.h \
     src/WebRequestParameters.h \
     src/NetworkTypes.h
 
@@ -51,6 +53,8 @@ SOURCES += \
     src/NetworkRequestLoader.cpp \
     src/WebRequest.cpp \
     src/WebLoader.cpp \
+    src/SharedWebLoader.cpp \
     src/HttpMultiPart.cpp \
     src/NetworkQueue.cpp \
+    src/NetworkCache.cpp \
     src/WebRequestParameters.cpp